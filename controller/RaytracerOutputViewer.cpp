@@ -6,7 +6,9 @@
 #include "tools/Trace.h"
 
 #include <d3dcompiler.h>
+#include <algorithm>
 #include <random>
+#include <thread>
 
 RaytracerOutputViewer::RaytracerOutputViewer(fisk::GraphicsFramework& aFramework, fisk::tools::V2ui aWindowSize, fisk::tools::V2ui aResolution)
 	: myFramework(aFramework)
@@ -21,11 +23,24 @@ RaytracerOutputViewer::RaytracerOutputViewer(fisk::GraphicsFramework& aFramework
 	, myTimescale(std::chrono::microseconds(10))
 	, myImageSelection(0)
 	, myImageversion(0)
+	, myDenoiser(aResolution)
+	, myConversionPool(std::max(std::thread::hardware_concurrency(), 2u) - 1)
+	, myDenoisedPasses(0)
 {
 	myFrameBuffer.resize(aResolution[0] * aResolution[1]);
 	CreateGraphicsResources();
 }
 
+RaytracerOutputViewer::~RaytracerOutputViewer()
+{
+	// waits for the chunks it has on the pool, they write to myFrameBuffer
+	if (myTask)
+	{
+		myTask.destroy();
+		myTask = {};
+	}
+}
+
 void RaytracerOutputViewer::DrawImage()
 {
 	FISK_TRACE("DrawImage");
@@ -82,7 +97,8 @@ void RaytracerOutputViewer::Imgui()
 		"Color",
 		"Time taken",
 		"Object",
-		"Renderer"
+		"Renderer",
+		"Denoised"
 	};
 
 	if (ImGui::BeginCombo("Channel", ChannelNames[static_cast<int>(myChannel)]))
@@ -124,6 +140,27 @@ void RaytracerOutputViewer::Imgui()
 		ImGui::Text("(%fns)", myTimescale.count());
 	}
 		break;
+	case RaytracerOutputViewer::Channel::Denoised:
+	{
+		Denoiser::Settings settings = myDenoiser.GetSettings();
+
+		int iterations = static_cast<int>(settings.myIterations);
+
+		bool changed = false;
+		changed |= ImGui::SliderInt("Iterations", &iterations, 1, 8);
+		changed |= ImGui::SliderFloat("Color sigma", &settings.myColorSigma, 0.001f, 1.f, "%.3f", ImGuiSliderFlags_Logarithmic);
+		changed |= ImGui::SliderFloat("Sub object weight", &settings.mySubObjectWeight, 0.f, 1.f);
+
+		if (changed)
+		{
+			settings.myIterations = static_cast<size_t>(iterations);
+			myDenoiser.SetSettings(settings);
+		}
+
+		if (changed || ImGui::Button("Denoise now"))
+			FlushImage(true);
+	}
+		break;
 	default:
 		break;
 	}
@@ -269,13 +306,25 @@ void RaytracerOutputViewer::FlushImage(bool aRestart)
 			FlushImageData(myFrameBuffer);
 			break;
 		case RaytracerOutputViewer::Channel::TimeTaken:
-			myTask = ConvertVectorsAsync(timeMutator, myFrameBuffer, 10us, textureData.Channel<TimeChannel>());
+			myTask = ConvertVectorsParallelAsync(myConversionPool, timeMutator, myFrameBuffer, textureData.Channel<TimeChannel>());
 			break;
 		case RaytracerOutputViewer::Channel::Object:
-			myTask = ConvertVectorsAsync(idMutator, myFrameBuffer, 10us, textureData.Channel<ObjectIdChannel>(), textureData.Channel<SubObjectIdChannel>());
+			myTask = ConvertVectorsParallelAsync(myConversionPool, idMutator, myFrameBuffer, textureData.Channel<ObjectIdChannel>(), textureData.Channel<SubObjectIdChannel>());
 			break;
 		case RaytracerOutputViewer::Channel::Renderer:
-			myTask = ConvertVectorsAsync(rendererMutator, myFrameBuffer, 10us, textureData.Channel<RendererChannel>());
+			myTask = ConvertVectorsParallelAsync(myConversionPool, rendererMutator, myFrameBuffer, textureData.Channel<RendererChannel>());
+			break;
+		case RaytracerOutputViewer::Channel::Denoised:
+		{
+			// too expensive to redo for every texel that comes in, only whole passes or when asked to
+			size_t completedPasses = textureData.GetVersion() / std::max<size_t>(static_cast<size_t>(myResolution[0]) * myResolution[1], 1);
+
+			if (!aRestart && completedPasses == myDenoisedPasses)
+				break;
+
+			myDenoisedPasses = completedPasses;
+			myTask = myDenoiser.DenoiseAsync(myConversionPool, textureData, myFrameBuffer);
+		}
 			break;
 		}
 
@@ -286,13 +335,12 @@ void RaytracerOutputViewer::FlushImage(bool aRestart)
 		return;
 
 	if (!myTask.done())
-	{
 		myTask.resume();
-		FlushImageData(myFrameBuffer);
-	}
 
+	// the pool is still writing to the frame buffer until the task is done
 	if (myTask.done())
 	{
+		FlushImageData(myFrameBuffer);
 		myTask.destroy();
 		myTask = {};
 	}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ConvertVector.h"
+#include "Denoiser.h"
+#include "ThreadPool.h"
 
 #include "GraphicsFramework.h"
 #include "RendererTypes.h"
@@ -15,6 +17,7 @@ class RaytracerOutputViewer
 {
 public:
 	RaytracerOutputViewer(fisk::GraphicsFramework& aFramework, fisk::tools::V2ui aWindowSize, fisk::tools::V2ui aResolution);
+	~RaytracerOutputViewer();
 
 	void DrawImage();
 	void Imgui();
@@ -35,7 +38,8 @@ private:
 		Color,
 		TimeTaken,
 		Object,
-		Renderer
+		Renderer,
+		Denoised
 	};
 
 	fisk::GraphicsFramework& myFramework;
@@ -51,11 +55,15 @@ private:
 	fisk::tools::V2ui myResolution;
 
 	std::vector<fisk::tools::V3f> myFrameBuffer;
+
+	Denoiser myDenoiser;
+	size_t myDenoisedPasses; // passes the texture had when the shown denoise was started
 	
 	int myImageSelection;
 	size_t myImageversion; 
 	
-	ConvertVectorCoroutine myTask;
+	ThreadPool myConversionPool;
+	ConvertVectorCoroutine myTask; // chunks run on myConversionPool, destroyed first thing in the destructor
 
 	Channel myChannel;
 
@@ -2,20 +2,42 @@
 #include "tools/SystemValues.h"
 
 #include "RenderClient.h"
+#include "CompactTexel.h"
 #include "NodeLimits.h"
 #include "Version.h"
 
 #include <iostream>
 
-RenderClient::RenderClient(RenderConfig aConfig, fisk::tools::V2ui aResolution, std::string aScene, std::shared_ptr<fisk::tools::TCPSocket> aSocket)
+RenderClient::RenderClient(RenderConfig aConfig, fisk::tools::V2ui aResolution, std::string aScene, std::shared_ptr<fisk::tools::TCPSocket> aSocket, size_t aLocalThreads)
 	: myTexture(aResolution, {})
 	, myState(State::SendSystemvalues)
 	, mySocket(aSocket)
 	, myReader(aSocket->GetReadStream())
 	, myWriter(aSocket->GetWriteStream())
 	, myRenderConfig(aConfig)
+	, myLocalThreads(aLocalThreads)
+	, myRemote(nullptr)
 {
+	if (!myRenderConfig.IsValid())
+	{
+		Fail("Invalid render config, samples per pass has to divide samples per texel");
+		return;
+	}
+
 	myScene = Scene::FromFile(aScene, aResolution);
+
+	if (myRenderConfig.myTexelEncoding == RenderConfig::CompactTexels)
+	{
+		bool fits = aResolution[0] <= CompactResult::MaxResolution
+			&& aResolution[1] <= CompactResult::MaxResolution
+			&& (!myScene || CompactTexel::CanEncode(*myScene, myRenderConfig.myRenderId));
+
+		if (!fits)
+		{
+			Log("Scene does not fit the compact texel encoding, falling back to full texels");
+			myRenderConfig.myTexelEncoding = RenderConfig::FullTexels;
+		}
+	}
 }
 
 void RenderClient::Update()
@@ -154,9 +176,34 @@ void RenderClient::StepSendScene()
 
 void RenderClient::StepStartRendering()
 {
-	myRenderer.emplace(myLimits.myMaxPending, mySocket->GetReadStream(), mySocket->GetWriteStream());
+	RenderCollection<TexelType>::CollectionType renderers;
+
+	std::unique_ptr<NetworkedRendererMaster<TexelType>> remote = std::make_unique<NetworkedRendererMaster<TexelType>>(myLimits.myMaxPending, mySocket->GetReadStream(), mySocket->GetWriteStream(), myRenderConfig.myTexelEncoding);
+	myRemote = remote.get();
+	renderers.push_back(std::move(remote));
+
+	if (myLocalThreads > 0 && myScene)
+	{
+		myLocalIntersector = std::make_unique<ClusteredIntersector>(*myScene, 8, 8);
+		myLocalRenderer = std::make_unique<LocalRenderer>(*myScene, *myLocalIntersector, myRenderConfig.GetSamplesPerPass(), myRenderConfig.myMinBounces, myRenderConfig.myRenderId);
+
+		for (size_t i = 0; i < myLocalThreads; i++)
+			renderers.push_back(std::make_unique<ThreadedRenderer<TexelType, LocalQueueSize>>(*myLocalRenderer));
 
-	myOrcherstrator.emplace(myTexture, *myRenderer);
+		Log("Rendering locally on " + std::to_string(myLocalThreads) + " threads");
+	}
+
+	myRenderer.emplace(std::move(renderers), RenderCollection<TexelType>::DispatchPolicy::ThroughputWeighted);
+
+	fisk::tools::V2ui tileSize = { TileSize, TileSize };
+
+	if (myLimits.myMaxPending < TileSize * TileSize * MinTilesInFlight)
+	{
+		Log("Node allows too few pending texels for tiles, requesting single texels");
+		tileSize = { 1, 1 };
+	}
+
+	myOrcherstrator.emplace(myTexture, *myRenderer, myRenderConfig.GetPasses(), myRenderConfig.GetSamplesPerPass(), tileSize);
 
 	Log("Rendering started");
 	myState = State::Running;
@@ -164,6 +211,12 @@ void RenderClient::StepStartRendering()
 
 void RenderClient::StepRunning()
 {
+	if (myRemote->HasFailed())
+	{
+		Fail("Node sent a malformed result batch");
+		return;
+	}
+
 	if (!myOrcherstrator->Update())
 		myState = State::FinishUp;
 }
@@ -5,12 +5,17 @@
 #include "tools/StreamWriter.h"
 #include "tools/TCPSocket.h"
 
+#include "intersectors/ClusteredIntersector.h"
+
 #include "NetworkedRenderer.h"
 #include "RendererTypes.h"
 #include "Orchestrator.h"
+#include "RayRenderer.h"
+#include "RenderCollection.h"
 #include "Scene.h"
 #include "RenderConfig.h"
 #include "NodeLimits.h"
+#include "ThreadedRenderer.h"
 
 #include <string>
 #include <memory>
@@ -18,7 +23,8 @@
 class RenderClient
 {
 public:
-	RenderClient(RenderConfig aConfig, fisk::tools::V2ui aResolution, std::string aScene, std::shared_ptr<fisk::tools::TCPSocket> aSocket);
+	/// aLocalThreads renders part of the image on this machine next to the node, 0 leaves everything to the node
+	RenderClient(RenderConfig aConfig, fisk::tools::V2ui aResolution, std::string aScene, std::shared_ptr<fisk::tools::TCPSocket> aSocket, size_t aLocalThreads);
 
 	void Update();
 
@@ -54,6 +60,16 @@ private:
 	void Log(std::string aMessage);
 	void Fail(std::string aReason);
 
+	// tiles cut the per message overhead to a header per tile, the node needs room for a few of them to stay busy
+	static constexpr unsigned int TileSize = 8; // square
+	static constexpr size_t MinTilesInFlight = 4;
+
+	// jobs per local thread, a tile is one job
+	static constexpr size_t LocalQueueSize = 16;
+
+	using TexelType = TextureType::PackedValues;
+	using LocalRenderer = RayRenderer<ClusteredIntersector, Camera>;
+
 	State myState;
 
 	std::unique_ptr<Scene> myScene;
@@ -62,7 +78,14 @@ private:
 	NodeLimits myLimits;
 	TextureType myTexture;
 	std::optional<Orchestrator<TextureType>> myOrcherstrator;
-	std::optional<NetworkedRendererMaster<TextureType::PackedValues>> myRenderer;
+
+	size_t myLocalThreads;
+	std::unique_ptr<ClusteredIntersector> myLocalIntersector;
+	std::unique_ptr<LocalRenderer> myLocalRenderer;
+
+	// the node and the local threads are fed through one collection, which hands out work by how fast each keeps up
+	std::optional<RenderCollection<TexelType>> myRenderer;
+	NetworkedRendererMaster<TexelType>* myRemote;
 	std::shared_ptr<fisk::tools::TCPSocket> mySocket;
 	fisk::tools::StreamReader myReader;
 	fisk::tools::StreamWriter myWriter;
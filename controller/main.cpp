@@ -2,7 +2,6 @@
 
 
 #include "Camera.h"
-#include "CheckeredRenderer.h"
 #include "GraphicsFramework.h"
 #include "ImguiHelper.h"
 #include "Orchestrator.h"
@@ -141,16 +140,22 @@ int main(int argc, char** argv)
 
 	constexpr size_t scaleFactor = 4;
 	constexpr size_t samples = 400;
+	constexpr size_t samplesPerPass = 16;
 
 	RenderConfig config;
 
 	config.myMode = RenderConfig::RaytracedClustered;
 	config.myRenderId = 1;
 	config.mySamplesPerTexel = samples;
+	config.mySamplesPerPass = samplesPerPass;
+	config.myTexelEncoding = RenderConfig::CompactTexels;
 
 	std::string scene = "../../scenes/Example.fbx";
 
-	RenderClient client(config, window.GetWindowSize() / scaleFactor, scene, std::make_shared<fisk::tools::TCPSocket>("104.154.30.17", "11587", 5s));
+	// half the machine, the rest is left for the window and converting results for display
+	const size_t localThreads = std::thread::hardware_concurrency() / 2;
+
+	RenderClient client(config, window.GetWindowSize() / scaleFactor, scene, std::make_shared<fisk::tools::TCPSocket>("104.154.30.17", "11587", 5s), localThreads);
 
 
 	RaytracerOutputViewer viewer(framework, window.GetWindowSize(), window.GetWindowSize() / scaleFactor);
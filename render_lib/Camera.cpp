@@ -1,5 +1,6 @@
 #include "Camera.h"
 
+#include <cmath>
 #include <random>
 
 Camera::Camera(fisk::tools::V2ui aScreenSize, fisk::tools::Ray<float, 3> aAim, float aXFov, Lens aLens)
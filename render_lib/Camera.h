@@ -6,8 +6,15 @@
 #include "tools/Shapes.h"
 
 #include "IRenderer.h"
+#include "TexelRect.h"
 
+#include <cassert>
+#include <cmath>
+#include <numbers>
 #include <optional>
+#include <random>
+#include <span>
+#include <vector>
 
 class Camera : public IRenderer<fisk::tools::Ray<float, 3>>
 {
@@ -27,6 +34,13 @@ public:
 
 	Result Render(fisk::tools::V2ui aUV) const;
 
+	/// Same distribution as Render, fills aOut with rays through a single texel
+	/// Defined below so renderers specialized on Camera can inline them into their texel loops
+	void RenderBatch(fisk::tools::V2ui aUV, std::span<Result> aOut) const;
+
+	/// aSamplesPerTexel rays for every texel in the tile, texel major in the tile's row major order
+	void RenderBatch(TexelRect aRect, size_t aSamplesPerTexel, std::span<Result> aOut) const;
+
 	std::optional<fisk::tools::V2f> GetScreenPos(fisk::tools::V3f aPoint);
 
 	fisk::tools::V3f GetPosition();
@@ -49,4 +63,74 @@ private:
 
 	fisk::tools::V3f myLensRight;
 	fisk::tools::V3f myLensUp;
-};
\ No newline at end of file
+};
+
+inline void Camera::RenderBatch(fisk::tools::V2ui aUV, std::span<Result> aOut) const
+{
+	RenderBatch(TexelRect{ aUV, { 1, 1 } }, aOut.size(), aOut);
+}
+
+inline void Camera::RenderBatch(TexelRect aRect, size_t aSamplesPerTexel, std::span<Result> aOut) const
+{
+	assert(aOut.size() == aRect.Area() * aSamplesPerTexel);
+
+	thread_local std::random_device seed;
+	thread_local std::mt19937 rng(seed());
+	thread_local std::uniform_real_distribution<float> uniformDist(0, 1);
+
+	// structure of arrays scratch, one entry per ray, kept per thread so it only grows once
+	thread_local std::vector<float> x;
+	thread_local std::vector<float> y;
+	thread_local std::vector<float> lensX;
+	thread_local std::vector<float> lensY;
+
+	const size_t count = aOut.size();
+
+	x.resize(count);
+	y.resize(count);
+	lensX.resize(count);
+	lensY.resize(count);
+
+	// per camera constants, Render recomputes these for every ray
+	const fisk::tools::V3f aim = -myLensPlane.myNormal;
+	const float lensDistance = Intersect(fisk::tools::Ray<float, 3>{ myPosition, aim }, myLensPlane).value_or(0.f);
+	const float xOffset = -static_cast<float>(myScreenSize[0]);
+	const float yOffset = -static_cast<float>(myScreenSize[1]);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		fisk::tools::V2ui uv = aRect.At(i / aSamplesPerTexel);
+
+		x[i] = static_cast<float>(uv[0] * 2) + xOffset + uniformDist(rng);
+		y[i] = static_cast<float>(uv[1] * 2) + yOffset + uniformDist(rng);
+
+		lensX[i] = uniformDist(rng);
+		lensY[i] = uniformDist(rng);
+	}
+
+	// box muller, gives the same normal distributed lens offsets as the normal_distribution in Render
+	for (size_t i = 0; i < count; i++)
+	{
+		float radius = std::sqrt(-2.f * std::log(1.f - lensX[i]));
+		float angle = 2.f * std::numbers::pi_v<float> * lensY[i];
+
+		lensX[i] = radius * std::cos(angle);
+		lensY[i] = radius * std::sin(angle);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		fisk::tools::V3f target = myFocalpoint + myCameraRight * x[i] + myCameraUp * y[i];
+		fisk::tools::V3f toTarget = target - myPosition;
+
+		// the lens plane faces the camera, so the hit distance along toTarget is lensDistance over its projection on the aim
+		fisk::tools::V3f lensSource = myPosition + toTarget * (lensDistance / toTarget.Dot(aim));
+
+		fisk::tools::V3f focallyDistortedSource = lensSource
+			+ myLensRight * lensX[i]
+			+ myLensUp * lensY[i];
+
+		aOut[i].myOrigin = focallyDistortedSource;
+		aOut[i].myDirection = (target - focallyDistortedSource).GetNormalized();
+	}
+}
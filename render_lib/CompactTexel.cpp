@@ -0,0 +1,137 @@
+#include "CompactTexel.h"
+
+#include "Scene.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace
+{
+	constexpr int MantissaBits = 9;
+	constexpr int ExponentBias = 15;
+	constexpr int MaxExponent = 31;
+
+	// largest value rgb9e5 can hold, (2^9 - 1) / 2^9 * 2^(31 - 15)
+	constexpr float MaxSharedExponentValue = static_cast<float>((1 << MantissaBits) - 1) / static_cast<float>(1 << MantissaBits) * static_cast<float>(1 << (MaxExponent - ExponentBias));
+}
+
+CompactTexel CompactTexel::Pack(const TextureType::PackedValues& aValues)
+{
+	CompactTexel out;
+
+	out.myColor = EncodeColor(std::get<ColorChannel>(aValues));
+	out.myTime = EncodeTime(std::get<TimeChannel>(aValues));
+	out.myObjectId = static_cast<uint16_t>(std::get<ObjectIdChannel>(aValues));
+	out.mySubObjectAndRenderer = (std::get<SubObjectIdChannel>(aValues) & MaxSubObjectId) | (std::get<RendererChannel>(aValues) << 24);
+
+	return out;
+}
+
+TextureType::PackedValues CompactTexel::Unpack() const
+{
+	return {
+		DecodeColor(myColor),
+		DecodeTime(myTime),
+		myObjectId,
+		mySubObjectAndRenderer & MaxSubObjectId,
+		mySubObjectAndRenderer >> 24
+	};
+}
+
+bool CompactTexel::CanEncode(const Scene& aScene, unsigned int aRendererId)
+{
+	if (aRendererId > MaxRendererId)
+		return false;
+
+	for (const SceneObject<PolyObject>& object : aScene.GetObjects())
+	{
+		if (object.myId > MaxObjectId)
+			return false;
+
+		// sub object ids are the triangle index plus one
+		if (object.myShape.myTris.size() > MaxSubObjectId - 1)
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t CompactTexel::EncodeColor(fisk::tools::V3f aColor)
+{
+	float r = std::clamp(aColor[0], 0.f, MaxSharedExponentValue);
+	float g = std::clamp(aColor[1], 0.f, MaxSharedExponentValue);
+	float b = std::clamp(aColor[2], 0.f, MaxSharedExponentValue);
+
+	// clamp does not catch nan
+	if (!(r == r)) r = 0.f;
+	if (!(g == g)) g = 0.f;
+	if (!(b == b)) b = 0.f;
+
+	float largest = std::max({ r, g, b });
+
+	if (largest == 0.f)
+		return 0;
+
+	int floorLog2;
+	std::frexp(largest, &floorLog2); // largest = m * 2^floorLog2 with m in [0.5, 1)
+	floorLog2 -= 1;
+
+	int exponent = std::max(-ExponentBias - 1, floorLog2) + 1 + ExponentBias;
+	float scale = std::ldexp(1.f, exponent - ExponentBias - MantissaBits);
+
+	if (static_cast<int>(std::floor(largest / scale + 0.5f)) == (1 << MantissaBits))
+	{
+		scale *= 2.f;
+		exponent++;
+	}
+
+	uint32_t rm = static_cast<uint32_t>(std::floor(r / scale + 0.5f));
+	uint32_t gm = static_cast<uint32_t>(std::floor(g / scale + 0.5f));
+	uint32_t bm = static_cast<uint32_t>(std::floor(b / scale + 0.5f));
+
+	return rm | (gm << 9) | (bm << 18) | (static_cast<uint32_t>(exponent) << 27);
+}
+
+fisk::tools::V3f CompactTexel::DecodeColor(uint32_t aColor)
+{
+	int exponent = static_cast<int>(aColor >> 27);
+	float scale = std::ldexp(1.f, exponent - ExponentBias - MantissaBits);
+
+	return {
+		static_cast<float>(aColor & 0x1FF) * scale,
+		static_cast<float>((aColor >> 9) & 0x1FF) * scale,
+		static_cast<float>((aColor >> 18) & 0x1FF) * scale
+	};
+}
+
+uint16_t CompactTexel::EncodeTime(CompactNanoSecond aTime)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(aTime.count());
+
+	// round to nearest even before dropping the low half
+	bits += 0x7FFF + ((bits >> 16) & 1);
+
+	return static_cast<uint16_t>(bits >> 16);
+}
+
+CompactNanoSecond CompactTexel::DecodeTime(uint16_t aTime)
+{
+	return CompactNanoSecond(std::bit_cast<float>(static_cast<uint32_t>(aTime) << 16));
+}
+
+CompactResult CompactResult::Pack(const std::pair<fisk::tools::V2ui, TextureType::PackedValues>& aResult)
+{
+	CompactResult out;
+
+	out.myU = static_cast<uint16_t>(aResult.first[0]);
+	out.myV = static_cast<uint16_t>(aResult.first[1]);
+	out.myTexel = CompactTexel::Pack(aResult.second);
+
+	return out;
+}
+
+std::pair<fisk::tools::V2ui, TextureType::PackedValues> CompactResult::Unpack() const
+{
+	return { { myU, myV }, myTexel.Unpack() };
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "tools/DataProcessor.h"
+#include "tools/MathVector.h"
+
+#include "RendererTypes.h"
+
+#include <cstdint>
+#include <utility>
+
+class Scene;
+
+/// Packed form of TextureType::PackedValues for the wire, 12 bytes instead of 28
+///  color:		rgb9e5, three 9 bit mantissas sharing a 5 bit exponent
+///  time:		bfloat16, the top half of the float
+///  ids:		16 bit object, 24 bit sub object and 8 bit renderer
+struct CompactTexel
+{
+	uint32_t myColor = 0;
+	uint16_t myTime = 0;
+	uint16_t myObjectId = 0;
+	uint32_t mySubObjectAndRenderer = 0; // sub object in the low 24 bits
+
+	static constexpr uint32_t MaxObjectId = 0xFFFF;
+	static constexpr uint32_t MaxSubObjectId = 0xFFFFFF;
+	static constexpr uint32_t MaxRendererId = 0xFF;
+
+	static CompactTexel Pack(const TextureType::PackedValues& aValues);
+	TextureType::PackedValues Unpack() const;
+
+	/// Whether every id the scene can produce fits, ids that do not fit would be silently truncated
+	static bool CanEncode(const Scene& aScene, unsigned int aRendererId);
+
+	static uint32_t EncodeColor(fisk::tools::V3f aColor);
+	static fisk::tools::V3f DecodeColor(uint32_t aColor);
+
+	static uint16_t EncodeTime(CompactNanoSecond aTime);
+	static CompactNanoSecond DecodeTime(uint16_t aTime);
+
+	inline bool Process(fisk::tools::DataProcessor& aProcessor)
+	{
+		return aProcessor.Process(myColor)
+			&& aProcessor.Process(myTime)
+			&& aProcessor.Process(myObjectId)
+			&& aProcessor.Process(mySubObjectAndRenderer);
+	}
+};
+
+/// A rendered texel as sent over the network in the compact encoding, 16 bytes instead of 36
+struct CompactResult
+{
+	uint16_t myU = 0;
+	uint16_t myV = 0;
+	CompactTexel myTexel;
+
+	static constexpr uint32_t MaxResolution = 0xFFFF;
+
+	static CompactResult Pack(const std::pair<fisk::tools::V2ui, TextureType::PackedValues>& aResult);
+	std::pair<fisk::tools::V2ui, TextureType::PackedValues> Unpack() const;
+
+	inline bool Process(fisk::tools::DataProcessor& aProcessor)
+	{
+		return aProcessor.Process(myU)
+			&& aProcessor.Process(myV)
+			&& myTexel.Process(aProcessor);
+	}
+};
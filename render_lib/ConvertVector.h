@@ -1,10 +1,15 @@
 #pragma once
 
+#include "ThreadPool.h"
+
 #include <typeinfo>
 #include <vector>
 #include <coroutine>
 #include <chrono>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 
 struct promise;
 
@@ -67,4 +72,107 @@ ConvertVectorCoroutine ConvertVectorsAsync(Functor aFunctor, std::vector<T2>& aO
 	}
 
 	co_return;
-}
\ No newline at end of file
+}
+
+/// Tracks the chunks a parallel conversion has handed to the pool, lives in the coroutine frame
+/// Destroying it cancels chunks that have not started yet and blocks until the ones that have are done, so the frame can go away at any time
+class ConvertVectorChunks
+{
+public:
+	/// Shared with every chunk, a chunk keeps it alive until it has signalled so the frame is never touched after Finished
+	class State
+	{
+	public:
+		inline bool IsCancelled() const
+		{
+			return myIsCancelled.load(std::memory_order_relaxed);
+		}
+
+		/// Last thing a chunk does, the frame may be gone right after
+		inline void Finished()
+		{
+			myDone.fetch_add(1, std::memory_order_release);
+
+			if (myInFlight.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				myInFlight.notify_all();
+		}
+
+	private:
+		friend class ConvertVectorChunks;
+
+		std::atomic<size_t> myDone = 0;
+		std::atomic<size_t> myInFlight = 0;
+		std::atomic<bool> myIsCancelled = false;
+	};
+
+	inline ConvertVectorChunks()
+		: myState(std::make_shared<State>())
+	{
+	}
+
+	inline ~ConvertVectorChunks()
+	{
+		myState->myIsCancelled.store(true, std::memory_order_relaxed);
+
+		size_t inFlight;
+		while ((inFlight = myState->myInFlight.load(std::memory_order_acquire)) != 0)
+			myState->myInFlight.wait(inFlight, std::memory_order_acquire);
+	}
+
+	ConvertVectorChunks(const ConvertVectorChunks&) = delete;
+	ConvertVectorChunks& operator=(const ConvertVectorChunks&) = delete;
+
+	/// Call once per chunk before submitting it, the chunk holds on to the result and calls Finished on it
+	inline std::shared_ptr<State> Start()
+	{
+		myState->myInFlight.fetch_add(1, std::memory_order_relaxed);
+
+		return myState;
+	}
+
+	/// Everything written by finished chunks is visible once this has returned the chunk count
+	inline size_t Done() const
+	{
+		return myState->myDone.load(std::memory_order_acquire);
+	}
+
+private:
+	std::shared_ptr<State> myState;
+};
+
+/// Same as ConvertVectorsAsync but the range is split over aPool in chunks that fit in cache, resuming never blocks and
+/// only reports progress until every chunk is done. aFunctor is called from several threads at once
+template<class... T1, class Functor, class T2 = decltype(std::declval<Functor&>()(std::declval<const T1&>()...))>
+ConvertVectorCoroutine ConvertVectorsParallelAsync(ThreadPool& aPool, Functor aFunctor, std::vector<T2>& aOutVector, std::vector<T1>... aVectors)
+{
+	assert(((aVectors.size() == aOutVector.size()) && ...));
+
+	constexpr size_t ChunkBytes = 32 * 1024;
+	constexpr size_t ChunkSize = std::max<size_t>(ChunkBytes / (sizeof(T2) + (sizeof(T1) + ... + 0)), 256);
+
+	const size_t size = aOutVector.size();
+	const size_t chunkCount = (size + ChunkSize - 1) / ChunkSize;
+
+	ConvertVectorChunks chunks;
+
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		aPool.Submit([&aFunctor, &aOutVector, &aVectors..., state = chunks.Start(), chunk, size]()
+		{
+			if (!state->IsCancelled())
+			{
+				size_t end = std::min(size, (chunk + 1) * ChunkSize);
+
+				for (size_t i = chunk * ChunkSize; i < end; i++)
+					aOutVector[i] = aFunctor(aVectors[i]...);
+			}
+
+			state->Finished();
+		});
+	}
+
+	while (chunks.Done() < chunkCount)
+		co_yield static_cast<float>(chunks.Done()) / static_cast<float>(chunkCount);
+
+	co_return;
+}
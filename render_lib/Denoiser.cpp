@@ -0,0 +1,224 @@
+#include "Denoiser.h"
+
+#include "tools/Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+
+namespace
+{
+	// B3 spline, the standard a-trous kernel
+	constexpr std::array<float, 5> Kernel = { 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+	/// e^aX for aX <= 0 without a library call so the tap loop vectorizes, relative error is around 1e-5
+	inline float NegativeExp(float aX)
+	{
+		// clamped as bits, for negative floats a larger pattern is a larger magnitude and an integer min stays branch free
+		// e^-87 is as close to 0 as the exponent bits go and nan lands there too
+		const float clamped = std::bit_cast<float>(std::min(std::bit_cast<uint32_t>(aX), std::bit_cast<uint32_t>(-87.f)));
+
+		// 2^x split into a whole power that goes straight into the exponent bits and a fraction in (-1, 0]
+		const float x = clamped * 1.44269504f;
+		const int32_t whole = static_cast<int32_t>(x);
+		const float y = (x - static_cast<float>(whole)) * 0.69314718f;
+
+		// taylor series of e^y, y is in (-ln 2, 0]
+		const float fraction = 1.f + y * (1.f + y * (1.f / 2.f + y * (1.f / 6.f + y * (1.f / 24.f + y * (1.f / 120.f + y * (1.f / 720.f))))));
+
+		return std::bit_cast<float>((whole + 127) << 23) * fraction;
+	}
+}
+
+void Denoiser::Planes::Resize(size_t aSize)
+{
+	myR.resize(aSize);
+	myG.resize(aSize);
+	myB.resize(aSize);
+}
+
+Denoiser::Denoiser(fisk::tools::V2ui aSize)
+	: Denoiser(aSize, Settings{})
+{
+}
+
+Denoiser::Denoiser(fisk::tools::V2ui aSize, Settings aSettings)
+	: mySize(aSize)
+	, mySettings(aSettings)
+{
+	size_t texels = static_cast<size_t>(mySize[0]) * mySize[1];
+
+	myFrom.Resize(texels);
+	myTo.Resize(texels);
+	myObjectIds.resize(texels);
+	mySubObjectIds.resize(texels);
+}
+
+ConvertVectorCoroutine Denoiser::DenoiseAsync(ThreadPool& aPool, const TextureType& aTexture, std::vector<fisk::tools::V3f>& aOut)
+{
+	const Settings settings = mySettings;
+	const size_t texels = static_cast<size_t>(mySize[0]) * mySize[1];
+
+	{
+		const std::vector<fisk::tools::V3f>& color = aTexture.Channel<ColorChannel>();
+		const std::vector<unsigned int>& objectIds = aTexture.Channel<ObjectIdChannel>();
+		const std::vector<unsigned int>& subObjectIds = aTexture.Channel<SubObjectIdChannel>();
+
+		assert(color.size() == texels);
+
+		Split(color, myFrom);
+
+		std::copy(objectIds.begin(), objectIds.end(), myObjectIds.begin());
+		std::copy(subObjectIds.begin(), subObjectIds.end(), mySubObjectIds.begin());
+	}
+
+	const size_t chunkCount = (mySize[1] + RowsPerChunk - 1) / RowsPerChunk;
+	const float totalChunks = static_cast<float>(std::max<size_t>(chunkCount * settings.myIterations, 1));
+
+	float colorSigma = settings.myColorSigma;
+
+	for (size_t i = 0; i < settings.myIterations; i++)
+	{
+		{
+			// destroying the coroutine here waits for the rows still being filtered
+			ConvertVectorChunks chunks;
+
+			for (uint32_t begin = 0; begin < mySize[1]; begin += RowsPerChunk)
+			{
+				uint32_t end = std::min(begin + RowsPerChunk, mySize[1]);
+
+				aPool.Submit([this, &settings, step = size_t(1) << i, colorSigma, begin, end, state = chunks.Start()]()
+				{
+					if (!state->IsCancelled())
+						FilterRows(settings, step, colorSigma, begin, end);
+
+					state->Finished();
+				});
+			}
+
+			while (chunks.Done() < chunkCount)
+				co_yield static_cast<float>(i * chunkCount + chunks.Done()) / totalChunks;
+		}
+
+		std::swap(myFrom, myTo);
+
+		colorSigma *= 0.5f;
+	}
+
+	aOut.resize(texels);
+
+	for (size_t i = 0; i < texels; i++)
+		aOut[i] = { myFrom.myR[i], myFrom.myG[i], myFrom.myB[i] };
+
+	co_return;
+}
+
+const Denoiser::Settings& Denoiser::GetSettings() const
+{
+	return mySettings;
+}
+
+void Denoiser::SetSettings(Settings aSettings)
+{
+	mySettings = aSettings;
+}
+
+void Denoiser::Split(std::span<const fisk::tools::V3f> aValues, Planes& aOut)
+{
+	aOut.Resize(aValues.size());
+
+	for (size_t i = 0; i < aValues.size(); i++)
+	{
+		aOut.myR[i] = aValues[i][0];
+		aOut.myG[i] = aValues[i][1];
+		aOut.myB[i] = aValues[i][2];
+	}
+}
+
+void Denoiser::FilterRows(const Settings& aSettings, size_t aStep, float aColorSigma, uint32_t aRowBegin, uint32_t aRowEnd)
+{
+	const int width = static_cast<int>(mySize[0]);
+	const int height = static_cast<int>(mySize[1]);
+	const int step = static_cast<int>(aStep);
+
+	const float inverseColorVariance = 1.f / std::max(aColorSigma * aColorSigma, 1e-8f);
+
+	const float* fromR = myFrom.myR.data();
+	const float* fromG = myFrom.myG.data();
+	const float* fromB = myFrom.myB.data();
+	const uint32_t* objectIds = myObjectIds.data();
+	const uint32_t* subObjectIds = mySubObjectIds.data();
+
+	for (int y = static_cast<int>(aRowBegin); y < static_cast<int>(aRowEnd); y++)
+	{
+		const size_t row = static_cast<size_t>(y) * width;
+
+		// a row is filtered a block at a time, the accumulators live on the stack so the compiler can see they
+		// alias none of the inputs and vectorizes the tap loop without runtime overlap checks
+		for (int blockBegin = 0; blockBegin < width; blockBegin += BlockWidth)
+		{
+			const int blockEnd = std::min(blockBegin + BlockWidth, width);
+
+			float sumR[BlockWidth] = {};
+			float sumG[BlockWidth] = {};
+			float sumB[BlockWidth] = {};
+			float sumWeight[BlockWidth] = {};
+
+			for (int ky = -2; ky <= 2; ky++)
+			{
+				const int sy = y + ky * step;
+
+				if (sy < 0 || sy >= height)
+					continue;
+
+				const size_t sampleRow = static_cast<size_t>(sy) * width;
+
+				for (int kx = -2; kx <= 2; kx++)
+				{
+					const int offset = kx * step;
+					const float kernelWeight = Kernel[ky + 2] * Kernel[kx + 2];
+					const float subObjectKernelWeight = kernelWeight * aSettings.mySubObjectWeight;
+
+					// clip the block so every tap inside the loop is in bounds
+					const int begin = std::max(blockBegin, -offset);
+					const int end = std::min(blockEnd, width - offset);
+
+					// branch free and call free, the compiler turns this into one lane per texel
+					for (int x = begin; x < end; x++)
+					{
+						const size_t center = row + x;
+						const size_t sample = sampleRow + x + offset;
+						const int local = x - blockBegin;
+
+						const float dr = fromR[sample] - fromR[center];
+						const float dg = fromG[sample] - fromG[center];
+						const float db = fromB[sample] - fromB[center];
+
+						const float sameObject = objectIds[sample] == objectIds[center] ? 1.f : 0.f;
+						const float tapWeight = subObjectIds[sample] == subObjectIds[center] ? kernelWeight : subObjectKernelWeight;
+
+						const float weight = sameObject * tapWeight * NegativeExp(-(dr * dr + dg * dg + db * db) * inverseColorVariance);
+
+						sumR[local] += fromR[sample] * weight;
+						sumG[local] += fromG[sample] * weight;
+						sumB[local] += fromB[sample] * weight;
+						sumWeight[local] += weight;
+					}
+				}
+			}
+
+			// the center tap always has a weight of its own so the sum is never zero
+			for (int x = blockBegin; x < blockEnd; x++)
+			{
+				const int local = x - blockBegin;
+				const float inverseWeight = 1.f / sumWeight[local];
+
+				myTo.myR[row + x] = sumR[local] * inverseWeight;
+				myTo.myG[row + x] = sumG[local] * inverseWeight;
+				myTo.myB[row + x] = sumB[local] * inverseWeight;
+			}
+		}
+	}
+}
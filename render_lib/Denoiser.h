@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tools/MathVector.h"
+
+#include "ConvertVector.h"
+#include "RendererTypes.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Edge avoiding a-trous wavelet filter, the id channels of the texture guide it so noise is only
+/// smoothed out within the surface it belongs to
+class Denoiser
+{
+public:
+	struct Settings
+	{
+		size_t myIterations = 5;			// filter radius doubles every iteration
+		float myColorSigma = 0.1f;			// halved every iteration, in ColorChannel units
+		float mySubObjectWeight = 0.25f;	// taps on a different sub object of the same object, 0 makes them hard edges too
+	};
+
+	Denoiser(fisk::tools::V2ui aSize);
+	Denoiser(fisk::tools::V2ui aSize, Settings aSettings);
+
+	/// Works on finished and progressive textures alike
+	/// The inputs are copied on the first resume and the rows are filtered on aPool, resuming never blocks. One at a time per Denoiser,
+	/// the settings are read when it starts
+	ConvertVectorCoroutine DenoiseAsync(ThreadPool& aPool, const TextureType& aTexture, std::vector<fisk::tools::V3f>& aOut);
+
+	const Settings& GetSettings() const;
+	void SetSettings(Settings aSettings);
+
+private:
+	/// One buffer per component so a row is walked as contiguous floats and the tap loop vectorizes
+	struct Planes
+	{
+		void Resize(size_t aSize);
+
+		std::vector<float> myR;
+		std::vector<float> myG;
+		std::vector<float> myB;
+	};
+
+	void Split(std::span<const fisk::tools::V3f> aValues, Planes& aOut);
+	void FilterRows(const Settings& aSettings, size_t aStep, float aColorSigma, uint32_t aRowBegin, uint32_t aRowEnd);
+
+	static constexpr uint32_t RowsPerChunk = 16;
+	static constexpr int BlockWidth = 64;		// texels of a row accumulated at once
+
+	fisk::tools::V2ui mySize;
+	Settings mySettings;
+
+	Planes myFrom;
+	Planes myTo;
+
+	std::vector<uint32_t> myObjectIds;
+	std::vector<uint32_t> mySubObjectIds;
+};
@@ -4,7 +4,9 @@
 #include "tools/MathVector.h"
 #include "Material.h"
 
+#include <cstdint>
 #include <optional>
+#include <span>
 
 class IIntersector
 {
@@ -12,5 +14,24 @@ public:
 	virtual ~IIntersector() = default;
 
 	virtual std::optional<Hit> Intersect(fisk::tools::Ray<float, 3> aRay) = 0;
+
+	/// Any-hit query, intersectors should override this with an early out
+	virtual bool Occluded(fisk::tools::Ray<float, 3> aRay)
+	{
+		return Intersect(aRay).has_value();
+	}
+
+	/// Batched versions of the queries above, the defaults fall back to one ray at a time
+	virtual void IntersectBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<std::optional<Hit>> aOutHits)
+	{
+		for (size_t i = 0; i < aRays.size(); i++)
+			aOutHits[i] = Intersect(aRays[i]);
+	}
+
+	virtual void OccludedBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<uint8_t> aOutOccluded)
+	{
+		for (size_t i = 0; i < aRays.size(); i++)
+			aOutOccluded[i] = Occluded(aRays[i]);
+	}
 };
 
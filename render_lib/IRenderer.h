@@ -4,14 +4,30 @@
 
 #include "tools/MathVector.h"
 
+#include "ResultSignal.h"
+#include "TexelRect.h"
+
+#include <span>
+#include <utility>
+#include <vector>
+
 template<class TexelType>
 class IRenderer
 {
 public:
 	using Result = TexelType;
 
+	virtual ~IRenderer() = default;
+
 	virtual Result Render(fisk::tools::V2ui aUV) const = 0;
 
+	/// aOut holds aRect.Area() texels in row major order, renderers override this to share work across the tile
+	virtual void RenderTile(TexelRect aRect, std::span<TexelType> aOut) const
+	{
+		for (size_t i = 0; i < aOut.size(); i++)
+			aOut[i] = Render(aRect.At(i));
+	}
+
 	virtual void Update() { }
 };
 
@@ -21,12 +37,52 @@ class IAsyncRenderer
 public:
 	using Result = std::pair<fisk::tools::V2ui, TexelType>;
 
+	struct TileResult
+	{
+		TexelRect myRect;
+		std::vector<TexelType> myTexels;
+	};
+
+	virtual ~IAsyncRenderer() = default;
+
 	virtual bool CanRender(fisk::tools::V2ui aUV) = 0;
 
 	virtual void Render(fisk::tools::V2ui aUV) = 0;
 	virtual bool GetResult(Result& aOut) = 0;
 
+	/// Submits texels from the front of aUVs until one is refused, returns how many were taken
+	virtual size_t RenderBatch(std::span<const fisk::tools::V2ui> aUVs)
+	{
+		size_t count = 0;
+
+		while (count < aUVs.size() && CanRender(aUVs[count]))
+			Render(aUVs[count++]);
+
+		return count;
+	}
+
+	/// Fills the front of aOut with finished results, returns how many were written
+	virtual size_t GetResults(std::span<Result> aOut)
+	{
+		size_t count = 0;
+
+		while (count < aOut.size() && GetResult(aOut[count]))
+			count++;
+
+		return count;
+	}
+
+	/// Tiles are opt in, callers fall back to single texels when this is false
+	virtual bool SupportsTiles() { return false; }
+
+	virtual bool CanRenderTile(TexelRect aRect) { return false; }
+	virtual void RenderTile(TexelRect aRect) { }
+	virtual bool GetTileResult(TileResult& aOut) { return false; }
+
 	virtual size_t GetPending() = 0;
 
+	/// aSignal is notified every time a result becomes available, nullptr to stop
+	virtual void SetResultSignal(ResultSignal* aSignal) { }
+
 	virtual void Update() { }
-};
\ No newline at end of file
+};
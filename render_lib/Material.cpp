@@ -1,5 +1,7 @@
 #include "Material.h"
 
+#include <algorithm>
+#include <numbers>
 #include <random>
 
 namespace material_randoms
@@ -10,19 +12,20 @@ namespace material_randoms
 	thread_local std::uniform_real_distribution<float> uniform(0, 1);
 }
 
-void Material::InteractWith(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const
+Material::Interaction Material::InteractWith(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const
 {
 
 	if (material_randoms::uniform(material_randoms::rng) < mySpecular)
 	{
 		ReflectSpecular(aInOutRay, aHit);
-		return;
+		return Interaction::Specular;
 	}
 
 	aColor *= myColor;
 	aInOutRay.myOrigin = aHit.myPosition;
 
 	ReflectDiffuse(aInOutRay, aHit, aColor);
+	return Interaction::Diffuse;
 }
 
 void Material::ReflectSpecular(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit) const
@@ -33,11 +36,19 @@ void Material::ReflectSpecular(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit)
 
 void Material::ReflectDiffuse(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const
 {
+	// normal + a uniform point on the unit sphere gives a cosine weighted direction
+	fisk::tools::V3f onSphere = fisk::tools::V3f(
+		material_randoms::normalDist(material_randoms::rng),
+		material_randoms::normalDist(material_randoms::rng),
+		material_randoms::normalDist(material_randoms::rng)).GetNormalized();
+
 	aInOutRay.myOrigin = aHit.myPosition;
-	aInOutRay.myDirection = (aHit.myNormal + fisk::tools::V3f(
-												material_randoms::normalDist(material_randoms::rng),
-												material_randoms::normalDist(material_randoms::rng),
-												material_randoms::normalDist(material_randoms::rng))).GetNormalized();
+	aInOutRay.myDirection = (aHit.myNormal + onSphere).GetNormalized();
+}
+
+float Material::DiffusePdf(fisk::tools::V3f aNormal, fisk::tools::V3f aDirection)
+{
+	return std::max(0.f, aNormal.Dot(aDirection)) / std::numbers::pi_v<float>;
 }
 
 bool Material::Process(fisk::tools::DataProcessor& aProcessor)
@@ -8,14 +8,23 @@
 class Material
 {
 public:
+	enum class Interaction
+	{
+		Specular,
+		Diffuse
+	};
+
 	fisk::tools::V3f myColor;
 	float mySpecular = 0.1f;
 
-	void InteractWith(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const;
+	Interaction InteractWith(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const;
 
 	void ReflectSpecular(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit) const;
 	void ReflectDiffuse(fisk::tools::Ray<float, 3>& aInOutRay, Hit& aHit, fisk::tools::V3f& aColor) const;
 
+	/// Solid angle density of the directions produced by ReflectDiffuse
+	static float DiffusePdf(fisk::tools::V3f aNormal, fisk::tools::V3f aDirection);
+
 	bool Process(fisk::tools::DataProcessor& aProcessor);
 };
 
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+
+/// Bounded lock-free queue, any number of threads may Push but only one thread may Pop
+/// Every cell carries a sequence number telling producers and the consumer whose turn it is
+template<class T>
+class MpscQueue
+{
+public:
+	/// aCapacity is rounded up to a power of two, and to at least 2 since a single cell's sequence after a push would
+	/// read as free to the next one
+	MpscQueue(size_t aCapacity);
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	/// Fails only when the queue is full, aValue is left as it was then
+	bool Push(T&& aValue);
+
+	/// Retries a full queue until the consumer makes room, yielding at first and then sleeping longer and longer
+	/// Returns false only if aGiveUp returned true before there was room
+	template<class GiveUp>
+	bool PushWait(T&& aValue, GiveUp&& aGiveUp);
+
+	bool Pop(T& aOut);
+
+	/// Pops into the front of aOut until it is full or the queue is empty, returns how many were written
+	size_t PopBulk(std::span<T> aOut);
+
+	size_t GetCapacity() const;
+
+private:
+	struct alignas(64) Cell
+	{
+		std::atomic<uint64_t> mySequence;
+		T myValue;
+	};
+
+	static size_t RoundUp(size_t aValue);
+
+	static constexpr int SpinsBeforeSleep = 16;
+	static constexpr std::chrono::microseconds MaxSleep = std::chrono::milliseconds(1);
+
+	size_t myMask;
+	std::unique_ptr<Cell[]> myCells;
+
+	alignas(64) std::atomic<uint64_t> myEnqueue;
+	alignas(64) uint64_t myDequeue;		// consumer only
+};
+
+template<class T>
+inline MpscQueue<T>::MpscQueue(size_t aCapacity)
+	: myMask(RoundUp(aCapacity) - 1)
+	, myCells(std::make_unique<Cell[]>(myMask + 1))
+	, myEnqueue(0)
+	, myDequeue(0)
+{
+	for (size_t i = 0; i <= myMask; i++)
+		myCells[i].mySequence.store(i, std::memory_order_relaxed);
+}
+
+template<class T>
+inline bool MpscQueue<T>::Push(T&& aValue)
+{
+	uint64_t position = myEnqueue.load(std::memory_order_relaxed);
+	Cell* cell;
+
+	while (true)
+	{
+		cell = &myCells[position & myMask];
+		uint64_t sequence = cell->mySequence.load(std::memory_order_acquire);
+		int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+
+		if (difference == 0)
+		{
+			// the cell is free for this position, race the other producers for it
+			if (myEnqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			// the consumer has not gotten to this cell since last lap
+			return false;
+		}
+		else
+		{
+			position = myEnqueue.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->myValue = std::move(aValue);
+	cell->mySequence.store(position + 1, std::memory_order_release);
+
+	return true;
+}
+
+template<class T>
+template<class GiveUp>
+inline bool MpscQueue<T>::PushWait(T&& aValue, GiveUp&& aGiveUp)
+{
+	int spins = 0;
+	std::chrono::microseconds sleep(1);
+
+	while (!Push(std::move(aValue)))
+	{
+		if (aGiveUp())
+			return false;
+
+		if (spins < SpinsBeforeSleep)
+		{
+			spins++;
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::this_thread::sleep_for(sleep);
+		sleep = std::min(sleep * 2, MaxSleep);
+	}
+
+	return true;
+}
+
+template<class T>
+inline bool MpscQueue<T>::Pop(T& aOut)
+{
+	Cell& cell = myCells[myDequeue & myMask];
+
+	if (cell.mySequence.load(std::memory_order_acquire) != myDequeue + 1)
+		return false;
+
+	aOut = std::move(cell.myValue);
+
+	// hand the cell to whoever pushes a lap from now
+	cell.mySequence.store(myDequeue + myMask + 1, std::memory_order_release);
+	myDequeue++;
+
+	return true;
+}
+
+template<class T>
+inline size_t MpscQueue<T>::PopBulk(std::span<T> aOut)
+{
+	size_t count = 0;
+
+	while (count < aOut.size() && Pop(aOut[count]))
+		count++;
+
+	return count;
+}
+
+template<class T>
+inline size_t MpscQueue<T>::GetCapacity() const
+{
+	return myMask + 1;
+}
+
+template<class T>
+inline size_t MpscQueue<T>::RoundUp(size_t aValue)
+{
+	size_t out = 2;
+
+	while (out < aValue)
+		out <<= 1;
+
+	return out;
+}
@@ -3,37 +3,91 @@
 #include "tools/StreamReader.h"
 #include "tools/StreamWriter.h"
 
+#include "CompactTexel.h"
 #include "IRenderer.h"
+#include "RenderConfig.h"
+#include "RenderMessages.h"
+#include "RendererTypes.h"
+
+#include <algorithm>
+#include <deque>
+#include <span>
+#include <type_traits>
 
 ///////////////////////////////////////////////////////// Master
 
+/// Texels and tiles go out as RenderRequests and come back in result batches as messages of the same kind, pending counts texels
 template<class TexelType>
 class NetworkedRendererMaster : public IAsyncRenderer<TexelType>
 {
 public:
+	using Result = IAsyncRenderer<TexelType>::Result;
+	using TileResult = IAsyncRenderer<TexelType>::TileResult;
+
 	NetworkedRendererMaster(size_t aMaxPending, fisk::tools::ReadStream& aReadStream, fisk::tools::WriteStream& aWriteStream);
 
+	/// aEncoding has to match the one in the RenderConfig sent to the node
+	NetworkedRendererMaster(size_t aMaxPending, fisk::tools::ReadStream& aReadStream, fisk::tools::WriteStream& aWriteStream, RenderConfig::TexelEncoding aEncoding);
+
 	bool CanRender(fisk::tools::V2ui aUV) override;
 
 	void Render(fisk::tools::V2ui aUV) override;
-	bool GetResult(IAsyncRenderer<TexelType>::Result& aOut) override;
+	bool GetResult(Result& aOut) override;
+
+	size_t RenderBatch(std::span<const fisk::tools::V2ui> aUVs) override;
+	size_t GetResults(std::span<Result> aOut) override;
+
+	bool SupportsTiles() override;
+
+	/// A tile takes as much of the node's budget as its texels would
+	bool CanRenderTile(TexelRect aRect) override;
+	void RenderTile(TexelRect aRect) override;
+	bool GetTileResult(TileResult& aOut) override;
 
 	size_t GetPending() override;
 
+	/// The node sent something that can not be an answer to what was asked, nothing more is read once this is set
+	bool HasFailed() const;
+
 private:
+	/// Reads one batch and decodes it into the queues of its kinds, returns false when there is no whole batch to read
+	bool ReadBatch();
+	void Unpack(ResultMessage<TexelType>& aMessage);
+
 	size_t myMaxPending;
 	size_t myPending;
+	size_t myUnread;			// texels asked for that have not come off the stream yet, bounds what a batch can hold
+	bool myHasFailed;
+	RenderConfig::TexelEncoding myEncoding;
 	fisk::tools::StreamReader myStreamReader;
 	fisk::tools::StreamWriter myStreamWriter;
+
+	// reused so batches and messages do not allocate every read
+	ResultBatch<TexelType> myBatch;
+	ResultMessage<TexelType> myMessage;
+
+	// read while looking for the other kind, handed out first
+	std::deque<Result> myTexels;
+	std::deque<TileResult> myTiles;
 };
 
 template<class TexelType>
 inline NetworkedRendererMaster<TexelType>::NetworkedRendererMaster(size_t aMaxPending, fisk::tools::ReadStream& aReadStream, fisk::tools::WriteStream& aWriteStream)
+	: NetworkedRendererMaster(aMaxPending, aReadStream, aWriteStream, RenderConfig::FullTexels)
+{
+}
+
+template<class TexelType>
+inline NetworkedRendererMaster<TexelType>::NetworkedRendererMaster(size_t aMaxPending, fisk::tools::ReadStream& aReadStream, fisk::tools::WriteStream& aWriteStream, RenderConfig::TexelEncoding aEncoding)
 	: myMaxPending(aMaxPending)
 	, myPending(0)
+	, myUnread(0)
+	, myHasFailed(false)
+	, myEncoding(aEncoding)
 	, myStreamReader(aReadStream)
 	, myStreamWriter(aWriteStream)
 {
+	myMessage.myEncoding = aEncoding;
 }
 
 template<class TexelType>
@@ -46,19 +100,105 @@ template<class TexelType>
 inline void NetworkedRendererMaster<TexelType>::Render(fisk::tools::V2ui aUV)
 {
 	myPending++;
+	myUnread++;
+
+	RenderRequest request;
+	request.myRect.myOrigin = aUV;
+
+	myStreamWriter.DataProcessor::Process(request);
+}
+
+template<class TexelType>
+inline bool NetworkedRendererMaster<TexelType>::GetResult(Result& aOut)
+{
+	while (myTexels.empty())
+	{
+		if (!ReadBatch())
+			return false;
+	}
+
+	aOut = std::move(myTexels.front());
+	myTexels.pop_front();
+	myPending--;
+
+	return true;
+}
+
+template<class TexelType>
+inline size_t NetworkedRendererMaster<TexelType>::RenderBatch(std::span<const fisk::tools::V2ui> aUVs)
+{
+	size_t count = std::min(aUVs.size(), myMaxPending - std::min(myPending, myMaxPending));
+
+	RenderRequest request;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		request.myRect.myOrigin = aUVs[i];
+		myStreamWriter.DataProcessor::Process(request);
+	}
+
+	myPending += count;
+	myUnread += count;
+
+	return count;
+}
+
+template<class TexelType>
+inline size_t NetworkedRendererMaster<TexelType>::GetResults(std::span<Result> aOut)
+{
+	// decode what has arrived first, then hand it out in one pass
+	while (myTexels.size() < aOut.size() && ReadBatch())
+	{
+	}
+
+	size_t count = std::min(aOut.size(), myTexels.size());
+
+	std::move(myTexels.begin(), myTexels.begin() + count, aOut.begin());
+	myTexels.erase(myTexels.begin(), myTexels.begin() + count);
+	myPending -= count;
+
+	return count;
+}
+
+template<class TexelType>
+inline bool NetworkedRendererMaster<TexelType>::SupportsTiles()
+{
+	return true;
+}
+
+template<class TexelType>
+inline bool NetworkedRendererMaster<TexelType>::CanRenderTile(TexelRect aRect)
+{
+	return myPending + aRect.Area() <= myMaxPending;
+}
+
+template<class TexelType>
+inline void NetworkedRendererMaster<TexelType>::RenderTile(TexelRect aRect)
+{
+	myPending += aRect.Area();
+	myUnread += aRect.Area();
 
-	aUV.Process(myStreamWriter);
+	RenderRequest request;
+	request.myKind = RenderRequest::Tile;
+	request.myRect = aRect;
+
+	myStreamWriter.DataProcessor::Process(request);
 }
 
 template<class TexelType>
-inline bool NetworkedRendererMaster<TexelType>::GetResult(IAsyncRenderer<TexelType>::Result& aOut)
+inline bool NetworkedRendererMaster<TexelType>::GetTileResult(TileResult& aOut)
 {
-	if (myStreamReader.ProcessAndCommit(aOut))
+	while (myTiles.empty())
 	{
-		myPending--;
-		return true;
+		if (!ReadBatch())
+			return false;
 	}
-	return false;
+
+	aOut = std::move(myTiles.front());
+	myTiles.pop_front();
+	myPending -= aOut.myRect.Area();
+
+	return true;
 }
 
 template<class TexelType>
@@ -67,6 +207,101 @@ inline size_t NetworkedRendererMaster<TexelType>::GetPending()
 	return myPending;
 }
 
+template<class TexelType>
+inline bool NetworkedRendererMaster<TexelType>::HasFailed() const
+{
+	return myHasFailed;
+}
+
+template<class TexelType>
+inline bool NetworkedRendererMaster<TexelType>::ReadBatch()
+{
+	if (myHasFailed)
+		return false;
+
+	if (!myStreamReader.ProcessAndCommit(myBatch))
+		return false;
+
+	// every message answers at least one texel that was asked for
+	if (myBatch.GetCount() == 0 || myBatch.GetCount() > myUnread)
+	{
+		myHasFailed = true;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < myBatch.GetCount(); i++)
+	{
+		myMessage.myMaxArea = myUnread;
+
+		if (!myBatch.Next(myMessage))
+		{
+			myHasFailed = true;
+			return false;
+		}
+
+		Unpack(myMessage);
+	}
+
+	if (!myBatch.IsFullyRead())
+	{
+		myHasFailed = true;
+		return false;
+	}
+
+	RenderRequest request;
+	request.myKind = RenderRequest::BatchRead;
+
+	myStreamWriter.DataProcessor::Process(request);
+
+	return true;
+}
+
+template<class TexelType>
+inline void NetworkedRendererMaster<TexelType>::Unpack(ResultMessage<TexelType>& aMessage)
+{
+	bool compact = false;
+
+	if constexpr (std::is_same_v<TexelType, TextureType::PackedValues>)
+		compact = myEncoding == RenderConfig::CompactTexels;
+
+	if (aMessage.myKind == RenderRequest::Texel)
+	{
+		myUnread--;
+
+		if constexpr (std::is_same_v<TexelType, TextureType::PackedValues>)
+		{
+			if (compact)
+			{
+				myTexels.push_back(aMessage.myCompactTexel.Unpack());
+				return;
+			}
+		}
+
+		myTexels.push_back(aMessage.myTexel);
+		return;
+	}
+
+	myUnread -= aMessage.myRect.Area();
+
+	TileResult& tile = myTiles.emplace_back();
+	tile.myRect = aMessage.myRect;
+
+	if constexpr (std::is_same_v<TexelType, TextureType::PackedValues>)
+	{
+		if (compact)
+		{
+			tile.myTexels.reserve(aMessage.myCompactTexels.size());
+
+			for (const CompactTexel& texel : aMessage.myCompactTexels)
+				tile.myTexels.push_back(texel.Unpack());
+
+			return;
+		}
+	}
+
+	tile.myTexels.swap(aMessage.myTexels);
+}
+
 
 ///////////////////////////////////////////////////////// Slave
 
@@ -86,6 +321,10 @@ private:
 
 	fisk::tools::StreamReader myStreamReader;
 	fisk::tools::StreamWriter myStreamWriter;
+
+	// always full texels
+	ResultBatch<TexelType> myBatch;
+	ResultMessage<TexelType> myMessage;
 };
 
 template<class TexelType>
@@ -100,15 +339,37 @@ inline NetworkedRendererSlave<TexelType>::NetworkedRendererSlave(fisk::tools::Re
 template<class TexelType>
 inline void NetworkedRendererSlave<TexelType>::Update()
 {
-	std::pair<fisk::tools::V2ui, TexelType> result;
+	RenderRequest request;
 
-	while (myStreamReader.ProcessAndCommit(result.first))
+	while (myStreamReader.ProcessAndCommit(request))
 	{
+		if (request.myKind == RenderRequest::BatchRead)
+			continue;
+
 		if (myLogger)
-			*myLogger << "Rendering x:" << result.first[0] << " y:" << result.first[1] << "\n";
-		result.second = myUnderlyingRenderer.Render(result.first);
-		myStreamWriter.DataProcessor::Process(result);
+			*myLogger << "Rendering x:" << request.myRect.myOrigin[0] << " y:" << request.myRect.myOrigin[1] << " w:" << request.myRect.mySize[0] << " h:" << request.myRect.mySize[1] << "\n";
+
+		myMessage.myKind = request.myKind;
+
+		if (request.myKind == RenderRequest::Texel)
+		{
+			myMessage.myTexel = { request.myRect.myOrigin, myUnderlyingRenderer.Render(request.myRect.myOrigin) };
+		}
+		else
+		{
+			myMessage.myRect = request.myRect;
+			myMessage.myTexels.resize(request.myRect.Area());
+			myUnderlyingRenderer.RenderTile(request.myRect, myMessage.myTexels);
+		}
+
+		myBatch.Add(myMessage);
 	}
+
+	if (myBatch.IsEmpty())
+		return;
+
+	myStreamWriter.DataProcessor::Process(myBatch);
+	myBatch.Clear();
 }
 
 template<class TexelType>
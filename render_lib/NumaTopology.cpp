@@ -0,0 +1,161 @@
+#include "NumaTopology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+NumaTopology NumaTopology::Detect()
+{
+	NumaTopology out;
+
+	std::vector<uint32_t> allowed = AllowedCpus();
+
+#ifdef __linux__
+	const std::filesystem::path nodes = "/sys/devices/system/node";
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(nodes, error))
+	{
+		std::string name = entry.path().filename().string();
+
+		if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), [](char aChar) { return aChar >= '0' && aChar <= '9'; }))
+			continue;
+
+		std::ifstream file(entry.path() / "cpulist");
+		std::string list;
+
+		if (!std::getline(file, list))
+			continue;
+
+		NumaDomain domain;
+		domain.myId = static_cast<uint32_t>(std::stoul(name.substr(4)));
+
+		for (uint32_t cpu : ParseCpuList(list))
+		{
+			if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+				domain.myCpus.push_back(cpu);
+		}
+
+		// memory only nodes, and nodes outside the affinity mask, have no cpus to put workers on
+		if (domain.myCpus.empty())
+			continue;
+
+		out.myDomains.push_back(std::move(domain));
+	}
+
+	std::sort(out.myDomains.begin(), out.myDomains.end(), [](const NumaDomain& aA, const NumaDomain& aB) { return aA.myId < aB.myId; });
+#endif
+
+	if (out.myDomains.empty())
+	{
+		NumaDomain& domain = out.myDomains.emplace_back();
+		domain.myId = 0;
+		domain.myCpus = std::move(allowed);
+	}
+
+	return out;
+}
+
+NumaTopology NumaTopology::SingleDomain(size_t aCpuCount)
+{
+	NumaTopology out;
+
+	NumaDomain& domain = out.myDomains.emplace_back();
+	domain.myId = 0;
+
+	for (size_t i = 0; i < aCpuCount; i++)
+		domain.myCpus.push_back(static_cast<uint32_t>(i));
+
+	return out;
+}
+
+const std::vector<NumaDomain>& NumaTopology::GetDomains() const
+{
+	return myDomains;
+}
+
+size_t NumaTopology::GetCpuCount() const
+{
+	size_t count = 0;
+
+	for (const NumaDomain& domain : myDomains)
+		count += domain.myCpus.size();
+
+	return count;
+}
+
+std::vector<uint32_t> NumaTopology::AllowedCpus()
+{
+	std::vector<uint32_t> out;
+
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	{
+		for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &set))
+				out.push_back(cpu);
+		}
+	}
+#endif
+
+	if (out.empty())
+	{
+		for (uint32_t cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+			out.push_back(cpu);
+	}
+
+	return out;
+}
+
+bool NumaTopology::PinCurrentThread(std::span<const uint32_t> aCpus)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+
+	for (uint32_t cpu : aCpus)
+	{
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	}
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+std::vector<uint32_t> NumaTopology::ParseCpuList(const std::string& aList)
+{
+	std::vector<uint32_t> out;
+
+	std::stringstream stream(aList);
+	std::string range;
+
+	while (std::getline(stream, range, ','))
+	{
+		if (range.empty() || range[0] < '0' || range[0] > '9')
+			continue;
+
+		size_t dash = range.find('-');
+
+		uint32_t first = static_cast<uint32_t>(std::stoul(range.substr(0, dash)));
+		uint32_t last = dash == std::string::npos ? first : static_cast<uint32_t>(std::stoul(range.substr(dash + 1)));
+
+		for (uint32_t cpu = first; cpu <= last; cpu++)
+			out.push_back(cpu);
+	}
+
+	return out;
+}
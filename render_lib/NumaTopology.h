@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+struct NumaDomain
+{
+	uint32_t myId;
+	std::vector<uint32_t> myCpus;
+};
+
+/// Which cpus share a memory controller, read from sysfs on linux and limited to the cpus the process may run on
+/// Everywhere else, and on machines without NUMA, it is a single domain holding every cpu
+class NumaTopology
+{
+public:
+	static NumaTopology Detect();
+	static NumaTopology SingleDomain(size_t aCpuCount);
+
+	const std::vector<NumaDomain>& GetDomains() const;
+	size_t GetCpuCount() const;
+
+	/// Cpus in the process' affinity mask, every cpu when there is no way to tell
+	static std::vector<uint32_t> AllowedCpus();
+
+	/// Restricts the calling thread to the given cpus, returns false if the platform does not support it or the call failed
+	static bool PinCurrentThread(std::span<const uint32_t> aCpus);
+
+	/// Parses the kernel's cpu list format, "0-3,8,10-11"
+	static std::vector<uint32_t> ParseCpuList(const std::string& aList);
+
+private:
+	std::vector<NumaDomain> myDomains;
+};
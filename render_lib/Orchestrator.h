@@ -7,7 +7,10 @@
 
 #include "IRenderer.h"
 #include "RegionGenerator.h"
+#include "RendererTypes.h"
 
+#include <optional>
+#include <span>
 #include <vector>
 
 template<class TextureType>
@@ -18,55 +21,256 @@ public:
 
 	Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer);
 
+	/// Progressive mode, every texel is scheduled once per pass and the results are accumulated
+	Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer, size_t aPasses, size_t aSamplesPerPass);
+
+	/// Schedules whole tiles when the renderer supports them, single texels otherwise
+	Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer, size_t aPasses, size_t aSamplesPerPass, fisk::tools::V2ui aTileSize);
+
 	bool Update();
 
+	/// Stops scheduling new texels, whatever is in flight is still merged
+	void Stop();
+
+	size_t GetPasses() const;
+	size_t GetCompletedPasses() const;
+
 private:
+	void Schedule();
+	void ScheduleTiles();
+	bool FillQueue();
+	bool HasWork();
+	bool StartNextPass();
+	void Merge(const typename IAsyncRenderer<TexelType>::Result& aResult);
+	void Merge(const typename IAsyncRenderer<TexelType>::TileResult& aResult);
+
 	TextureType& myTexture;
 
 	RegionGenerator myGenerator;
 	IAsyncRenderer<TexelType>& myRenderer;
+
+	fisk::tools::V2ui myTileSize;
+	bool myUseTiles;
+
+	size_t myPasses;
+	size_t myPass;
+	size_t mySamplesPerPass;
+	size_t myMerged;
+	bool myIsStopped;
+
+	static constexpr size_t BatchSize = 256;
+
+	std::vector<fisk::tools::V2ui> myQueue; // texels taken from the generator that the renderer has not accepted yet
+	size_t myQueueAt;
+	std::vector<typename IAsyncRenderer<TexelType>::Result> myResults;
+
+	std::optional<AccumulationTextureType> myAccumulation;
 };
 
 template<class TextureType>
 inline Orchestrator<TextureType>::Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer)
+	: Orchestrator(aTexture, aRenderer, 1, 0)
+{
+}
+
+template<class TextureType>
+inline Orchestrator<TextureType>::Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer, size_t aPasses, size_t aSamplesPerPass)
+	: Orchestrator(aTexture, aRenderer, aPasses, aSamplesPerPass, { 1, 1 })
+{
+}
+
+template<class TextureType>
+inline Orchestrator<TextureType>::Orchestrator(TextureType& aTexture, IAsyncRenderer<TexelType>& aRenderer, size_t aPasses, size_t aSamplesPerPass, fisk::tools::V2ui aTileSize)
 	: myTexture(aTexture)
 	, myGenerator(aTexture.GetSize())
 	, myRenderer(aRenderer)
+	, myTileSize(aTileSize)
+	, myUseTiles(aTileSize[0] * aTileSize[1] > 1 && aRenderer.SupportsTiles())
+	, myPasses(aPasses)
+	, myPass(0)
+	, mySamplesPerPass(aSamplesPerPass)
+	, myMerged(0)
+	, myIsStopped(false)
+	, myQueueAt(0)
 {
+	myQueue.reserve(BatchSize);
+	myResults.resize(BatchSize);
+
+	if (myUseTiles)
+		myGenerator = RegionGenerator(aTexture.GetSize(), myTileSize);
+
+	if (myPasses > 1)
+		myAccumulation.emplace(aTexture.GetSize(), AccumulationTextureType::PackedValues{});
 }
 
 template<class TextureType>
 inline bool Orchestrator<TextureType>::Update()
 {
 	FISK_TRACE("update");
-	if (!myGenerator.Done())
+	if (HasWork())
 	{
 		FISK_TRACE("scheduling");
 
-		while (myRenderer.CanRender(myGenerator.Get()))
-		{
-			myRenderer.Render(myGenerator.Get());
-				
-			if (!myGenerator.Next())
-				break;
-		}
+		if (myUseTiles)
+			ScheduleTiles();
+		else
+			Schedule();
 	}
 
 	{
 		FISK_TRACE("merging");
 
-		typename IAsyncRenderer<TexelType>::Result result;
-		while (myRenderer.GetResult(result))
+		size_t count;
+		do
+		{
+			count = myRenderer.GetResults(myResults);
+
+			for (size_t i = 0; i < count; i++)
+				Merge(myResults[i]);
+
+		} while (count == myResults.size());
+
+		if (myUseTiles)
 		{
-			myTexture.SetTexel(result.first, result.second);
+			typename IAsyncRenderer<TexelType>::TileResult tile;
+			while (myRenderer.GetTileResult(tile))
+			{
+				Merge(tile);
+			}
 		}
 	}
 
-	if (!myGenerator.Done())
+	if (HasWork())
 		return true;
 
 	if (myRenderer.GetPending() > 0)
 		return true;
 
 	return false;
-}
\ No newline at end of file
+}
+
+template<class TextureType>
+inline void Orchestrator<TextureType>::Stop()
+{
+	myIsStopped = true;
+
+	myQueue.clear();
+	myQueueAt = 0;
+}
+
+template<class TextureType>
+inline size_t Orchestrator<TextureType>::GetPasses() const
+{
+	return myPasses;
+}
+
+template<class TextureType>
+inline size_t Orchestrator<TextureType>::GetCompletedPasses() const
+{
+	fisk::tools::V2ui size = myTexture.GetSize();
+
+	return myMerged / (static_cast<size_t>(size[0]) * size[1]);
+}
+
+template<class TextureType>
+inline void Orchestrator<TextureType>::Schedule()
+{
+	while (myQueueAt < myQueue.size() || FillQueue())
+	{
+		size_t accepted = myRenderer.RenderBatch(std::span<const fisk::tools::V2ui>(myQueue).subspan(myQueueAt));
+
+		myQueueAt += accepted;
+
+		if (myQueueAt < myQueue.size())
+			break;
+	}
+}
+
+template<class TextureType>
+inline bool Orchestrator<TextureType>::FillQueue()
+{
+	myQueue.clear();
+	myQueueAt = 0;
+
+	while (myQueue.size() < BatchSize && !myGenerator.Done())
+	{
+		myQueue.push_back(myGenerator.Get());
+
+		if (!myGenerator.Next() && !StartNextPass())
+			break;
+	}
+
+	return !myQueue.empty();
+}
+
+template<class TextureType>
+inline bool Orchestrator<TextureType>::HasWork()
+{
+	if (myIsStopped)
+		return false;
+
+	return !myGenerator.Done() || myQueueAt < myQueue.size();
+}
+
+template<class TextureType>
+inline void Orchestrator<TextureType>::ScheduleTiles()
+{
+	while (myRenderer.CanRenderTile(myGenerator.GetTile()))
+	{
+		myRenderer.RenderTile(myGenerator.GetTile());
+
+		if (!myGenerator.Next() && !StartNextPass())
+			break;
+	}
+}
+
+template<class TextureType>
+inline bool Orchestrator<TextureType>::StartNextPass()
+{
+	if (myIsStopped)
+		return false;
+
+	if (myPass + 1 >= myPasses)
+		return false;
+
+	myPass++;
+	myGenerator = RegionGenerator(myTexture.GetSize(), myUseTiles ? myTileSize : fisk::tools::V2ui{ 1, 1 });
+
+	return true;
+}
+
+template<class TextureType>
+inline void Orchestrator<TextureType>::Merge(const typename IAsyncRenderer<TexelType>::Result& aResult)
+{
+	myMerged++;
+
+	if (!myAccumulation)
+	{
+		myTexture.SetTexel(aResult.first, aResult.second);
+		return;
+	}
+
+	float weight = static_cast<float>(mySamplesPerPass);
+
+	auto [color, time, samples] = myAccumulation->GetTexel(aResult.first);
+
+	color += UnresolveColor(std::get<ColorChannel>(aResult.second)) * weight;
+	time += std::get<TimeChannel>(aResult.second) * weight;
+	samples += static_cast<uint32_t>(mySamplesPerPass);
+
+	myAccumulation->SetTexel(aResult.first, { color, time, samples });
+
+	TexelType merged = aResult.second;
+
+	std::get<ColorChannel>(merged) = ResolveColor(color / static_cast<float>(samples));
+	std::get<TimeChannel>(merged) = time / static_cast<float>(samples);
+
+	myTexture.SetTexel(aResult.first, merged);
+}
+
+template<class TextureType>
+inline void Orchestrator<TextureType>::Merge(const typename IAsyncRenderer<TexelType>::TileResult& aResult)
+{
+	for (size_t i = 0; i < aResult.myTexels.size(); i++)
+		Merge({ aResult.myRect.At(i), aResult.myTexels[i] });
+}
@@ -0,0 +1,184 @@
+#include "PathTracing.h"
+
+#include "Material.h"
+
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <utility>
+
+namespace path_tracing
+{
+	namespace randoms
+	{
+		thread_local std::random_device seed;
+		thread_local std::mt19937 rng(seed());
+		thread_local std::uniform_real_distribution<float> uniform(0, 1);
+	}
+
+	float Statistics::AveragePathLength() const
+	{
+		if (myPaths == 0)
+			return 0.f;
+
+		return static_cast<float>(mySegments) / static_cast<float>(myPaths);
+	}
+
+	void StatisticsCounter::Add(const Statistics& aStatistics)
+	{
+		myPaths += aStatistics.myPaths;
+		mySegments += aStatistics.mySegments;
+		myTerminated += aStatistics.myTerminated;
+		myIntersectionTime += aStatistics.myIntersectionTime;
+	}
+
+	Statistics StatisticsCounter::Get() const
+	{
+		Statistics out;
+
+		out.myPaths = myPaths;
+		out.mySegments = mySegments;
+		out.myTerminated = myTerminated;
+		out.myIntersectionTime = myIntersectionTime;
+
+		return out;
+	}
+
+	float RandomUniform()
+	{
+		return randoms::uniform(randoms::rng);
+	}
+
+	float PowerHeuristic(float aPdf, float aOtherPdf)
+	{
+		float squared = aPdf * aPdf;
+		float otherSquared = aOtherPdf * aOtherPdf;
+
+		if (squared + otherSquared <= 0.f)
+			return 0.f;
+
+		return squared / (squared + otherSquared);
+	}
+
+	std::optional<SunSample> SampleSun(const Sky& aSky, const Hit& aHit)
+	{
+		fisk::tools::V3f direction = aSky.SampleSunDirection(RandomUniform(), RandomUniform());
+
+		float bsdfPdf = Material::DiffusePdf(aHit.myNormal, direction);
+
+		if (bsdfPdf <= 0.f)
+			return {};
+
+		float lightPdf = aSky.SunPdf();
+
+		SunSample out;
+
+		out.myShadowRay.myOrigin = aHit.myPosition + aHit.myNormal * ShadowBias;
+		out.myShadowRay.myDirection = direction;
+
+		// what remains of the diffuse bsdf * cosine after the albedo is the bsdf pdf
+		out.myRadiance = aSky.GetSunColor() * (bsdfPdf * PowerHeuristic(lightPdf, bsdfPdf) / lightPdf);
+
+		return out;
+	}
+
+	fisk::tools::V3f EscapeRadiance(const Sky& aSky, fisk::tools::V3f aDirection, std::optional<fisk::tools::V3f> aDiffuseNormal)
+	{
+		fisk::tools::V3f emission = aSky.Emission(aDirection);
+
+		if (aDiffuseNormal && aSky.IsSun(aDirection))
+			emission *= PowerHeuristic(Material::DiffusePdf(*aDiffuseNormal, aDirection), aSky.SunPdf());
+
+		return emission;
+	}
+
+	bool SurvivesRoulette(fisk::tools::V3f& aInOutThroughput)
+	{
+		float survivalChance = std::min(std::max({ aInOutThroughput[0], aInOutThroughput[1], aInOutThroughput[2] }), MaxSurvivalChance);
+
+		if (RandomUniform() >= survivalChance)
+		{
+			aInOutThroughput = { 0, 0, 0 };
+			return false;
+		}
+
+		aInOutThroughput /= survivalChance;
+		return true;
+	}
+
+	void ResolveSamples(std::span<const Sample> aSamples, TextureType::PackedValues& aOut)
+	{
+		ResolveTile(aSamples, aSamples.size(), std::span<TextureType::PackedValues>(&aOut, 1));
+	}
+
+	void ResolveTile(std::span<const Sample> aSamples, size_t aSamplesPerTexel, std::span<TextureType::PackedValues> aOut)
+	{
+		assert(aSamples.size() == aSamplesPerTexel * aOut.size());
+
+		// the ids of the whole tile are pulled out in one pass, sorting a texel's range then groups it by object with
+		// the sub objects of each object in order, so both votes are a single scan over the same buffer
+		thread_local std::vector<std::pair<unsigned int, unsigned int>> ids;
+
+		ids.resize(aSamples.size());
+		for (size_t i = 0; i < aSamples.size(); i++)
+			ids[i] = { aSamples[i].myObjectId, aSamples[i].mySubObjectId };
+
+		for (size_t texel = 0; texel < aOut.size(); texel++)
+		{
+			size_t begin = texel * aSamplesPerTexel;
+			size_t end = begin + aSamplesPerTexel;
+
+			fisk::tools::V3f color{ 0, 0, 0 };
+
+			for (size_t i = begin; i < end; i++)
+				color += aSamples[i].myColor;
+
+			color /= static_cast<float>(aSamplesPerTexel);
+
+			std::sort(ids.begin() + begin, ids.begin() + end);
+
+			// ties go to the lowest id
+			size_t mostHitAt = begin;
+			size_t hits = 0;
+
+			for (size_t run = begin; run < end;)
+			{
+				size_t runEnd = run + 1;
+				while (runEnd < end && ids[runEnd].first == ids[run].first)
+					runEnd++;
+
+				if (runEnd - run > hits)
+				{
+					mostHitAt = run;
+					hits = runEnd - run;
+				}
+
+				run = runEnd;
+			}
+
+			unsigned int mostHitSubObject = 0;
+			size_t subHits = 0;
+
+			for (size_t run = mostHitAt; run < mostHitAt + hits;)
+			{
+				size_t runEnd = run + 1;
+				while (runEnd < mostHitAt + hits && ids[runEnd].second == ids[run].second)
+					runEnd++;
+
+				if (runEnd - run > subHits)
+				{
+					mostHitSubObject = ids[run].second;
+					subHits = runEnd - run;
+				}
+
+				run = runEnd;
+			}
+
+			TextureType::PackedValues& out = aOut[texel];
+
+			std::get<ColorChannel>(out) = ResolveColor(color);
+			std::get<ObjectIdChannel>(out) = hits > 0 ? ids[mostHitAt].first : 0;
+			std::get<SubObjectIdChannel>(out) = mostHitSubObject;
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "tools/MathVector.h"
+#include "tools/Shapes.h"
+
+#include "Hit.h"
+#include "RendererTypes.h"
+#include "Sky.h"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+/// Light transport shared by the renderers, everything here works on a single path vertex
+namespace path_tracing
+{
+	static constexpr size_t MaxBounces = 16;
+	static constexpr float MaxSurvivalChance = 0.95f;
+	static constexpr float ShadowBias = 0.0001f;
+
+	struct Sample
+	{
+		fisk::tools::V3f myColor{ 0, 0, 0 };
+		unsigned int myObjectId = 0;
+		unsigned int mySubObjectId = 0;
+	};
+
+	struct Statistics
+	{
+		uint64_t myPaths = 0;
+		uint64_t mySegments = 0;
+		uint64_t myTerminated = 0; // paths ended by russian roulette
+		uint64_t myIntersectionTime = 0; // nanoseconds, only measured by the batched renderers
+
+		float AveragePathLength() const;
+	};
+
+	/// Shared between worker threads, add once per texel rather than once per segment
+	class StatisticsCounter
+	{
+	public:
+		void Add(const Statistics& aStatistics);
+		Statistics Get() const;
+
+	private:
+		std::atomic<uint64_t> myPaths = 0;
+		std::atomic<uint64_t> mySegments = 0;
+		std::atomic<uint64_t> myTerminated = 0;
+		std::atomic<uint64_t> myIntersectionTime = 0;
+	};
+
+	struct SunSample
+	{
+		fisk::tools::Ray<float, 3> myShadowRay;
+		fisk::tools::V3f myRadiance; // MIS weighted, only to be added if the shadow ray is unoccluded
+	};
+
+	float RandomUniform();
+
+	float PowerHeuristic(float aPdf, float aOtherPdf);
+
+	/// Next event estimation towards the sun from a diffuse hit, the albedo is expected to already be in the throughput
+	std::optional<SunSample> SampleSun(const Sky& aSky, const Hit& aHit);
+
+	/// Radiance of a path escaping the scene, aDiffuseNormal is set when the previous bounce was diffuse
+	fisk::tools::V3f EscapeRadiance(const Sky& aSky, fisk::tools::V3f aDirection, std::optional<fisk::tools::V3f> aDiffuseNormal);
+
+	/// Russian roulette, reweights surviving paths and zeroes terminated ones
+	bool SurvivesRoulette(fisk::tools::V3f& aInOutThroughput);
+
+	/// Writes the resolved mean color and the most hit object/sub object of the samples
+	void ResolveSamples(std::span<const Sample> aSamples, TextureType::PackedValues& aOut);
+
+	/// ResolveSamples for every texel of a tile at once, aSamples holds aSamplesPerTexel samples per texel in the order of aOut
+	void ResolveTile(std::span<const Sample> aSamples, size_t aSamplesPerTexel, std::span<TextureType::PackedValues> aOut);
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "IRenderer.h"
+#include "MpscQueue.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+/// Async renderer on top of the node wide ThreadPool, texels are submitted as small tasks so a slow texel
+/// only holds up the worker it landed on while the others steal around it
+/// With one base renderer per NUMA domain of the pool every texel is rendered by the one local to the worker that runs it
+template<class TexelType>
+class PooledRenderer : public IAsyncRenderer<TexelType>
+{
+public:
+	using Result = IAsyncRenderer<TexelType>::Result;
+	using TileResult = IAsyncRenderer<TexelType>::TileResult;
+
+	PooledRenderer(ThreadPool& aPool, IRenderer<TexelType>& aBaseRenderer, size_t aMaxPending);
+
+	/// aDomainRenderers is indexed by pool domain and has to cover all of them
+	PooledRenderer(ThreadPool& aPool, std::vector<IRenderer<TexelType>*> aDomainRenderers, size_t aMaxPending);
+
+	/// Cancels the texels that have not been rendered yet and blocks until every task referencing this renderer has finished
+	~PooledRenderer();
+
+	PooledRenderer(const PooledRenderer&) = delete;
+	PooledRenderer& operator=(const PooledRenderer&) = delete;
+
+	bool CanRender(fisk::tools::V2ui aUV) override;
+
+	void Render(fisk::tools::V2ui aUV) override;
+	bool GetResult(Result& aOut) override;
+
+	size_t RenderBatch(std::span<const fisk::tools::V2ui> aUVs) override;
+	size_t GetResults(std::span<Result> aOut) override;
+
+	bool SupportsTiles() override;
+
+	bool CanRenderTile(TexelRect aRect) override;
+	void RenderTile(TexelRect aRect) override;
+	bool GetTileResult(TileResult& aOut) override;
+
+	size_t GetPending() override;
+
+	void SetResultSignal(ResultSignal* aSignal) override;
+
+	/// Lowers or raises the in flight cap, never above what the renderer was created with
+	/// Work already in flight above a lowered cap is left to finish
+	void SetMaxPending(size_t aMaxPending);
+
+	/// Texels rendered by the workers of a domain, tiles count every texel in them
+	size_t GetRenderedTexels(size_t aDomain) const;
+
+	/// Time spent in tasks, summed over all workers
+	std::chrono::nanoseconds GetBusyTime() const;
+
+private:
+	static constexpr size_t TexelsPerTask = 8;
+	static constexpr unsigned int RowsPerAffinity = 4;	// neighbouring rows go to the same worker to share caches
+
+	void RenderTexels(std::vector<fisk::tools::V2ui> aUVs);
+	void Finish(size_t aDomain, size_t aTexels, std::chrono::steady_clock::time_point aStart);
+
+	/// Last thing a task does, after it this may already be destroyed so only the shared counter is touched
+	static void Leave(std::atomic<size_t>& aInFlight);
+
+	/// Domain of the calling worker
+	size_t LocalDomain() const;
+
+	ThreadPool& myPool;
+	std::vector<IRenderer<TexelType>*> myBaseRenderers;	// one per domain
+	std::unique_ptr<std::atomic<size_t>[]> myRenderedTexels;	// one per domain
+	std::atomic<int64_t> myBusyNanoseconds;
+	size_t myCapacity;
+	size_t myMaxPending;
+	size_t myPending;								// External thread
+
+	// results count as pending until they are taken and pending never goes past myCapacity, so these can not fill up
+	// The tasks still push with PushWait, a full queue stalls the worker instead of dropping a result
+	MpscQueue<Result> myResults;
+	MpscQueue<TileResult> myTileResults;
+
+	std::shared_ptr<std::atomic<size_t>> myInFlight;	// shared with the tasks so the last one can notify the destructor safely
+	std::atomic<bool> myIsCancelled;
+
+	std::atomic<ResultSignal*> myResultSignal;
+};
+
+template<class TexelType>
+inline PooledRenderer<TexelType>::PooledRenderer(ThreadPool& aPool, IRenderer<TexelType>& aBaseRenderer, size_t aMaxPending)
+	: PooledRenderer(aPool, std::vector<IRenderer<TexelType>*>(aPool.GetDomainCount(), &aBaseRenderer), aMaxPending)
+{
+}
+
+template<class TexelType>
+inline PooledRenderer<TexelType>::PooledRenderer(ThreadPool& aPool, std::vector<IRenderer<TexelType>*> aDomainRenderers, size_t aMaxPending)
+	: myPool(aPool)
+	, myBaseRenderers(std::move(aDomainRenderers))
+	, myRenderedTexels(std::make_unique<std::atomic<size_t>[]>(aPool.GetDomainCount()))
+	, myBusyNanoseconds(0)
+	, myCapacity(aMaxPending)
+	, myMaxPending(aMaxPending)
+	, myPending(0)
+	, myResults(aMaxPending)
+	, myTileResults(aMaxPending)
+	, myInFlight(std::make_shared<std::atomic<size_t>>(0))
+	, myIsCancelled(false)
+	, myResultSignal(nullptr)
+{
+	assert(myBaseRenderers.size() == myPool.GetDomainCount());
+}
+
+template<class TexelType>
+inline PooledRenderer<TexelType>::~PooledRenderer()
+{
+	// the session is gone, nobody is waiting for the rest of its texels
+	myIsCancelled.store(true, std::memory_order_relaxed);
+
+	size_t inFlight;
+	while ((inFlight = myInFlight->load(std::memory_order_acquire)) != 0)
+		myInFlight->wait(inFlight, std::memory_order_acquire);
+}
+
+template<class TexelType>
+inline bool PooledRenderer<TexelType>::CanRender(fisk::tools::V2ui aUV)
+{
+	return myPending < myMaxPending;
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::Render(fisk::tools::V2ui aUV)
+{
+	RenderBatch(std::span<const fisk::tools::V2ui>(&aUV, 1));
+}
+
+template<class TexelType>
+inline bool PooledRenderer<TexelType>::GetResult(Result& aOut)
+{
+	return GetResults(std::span<Result>(&aOut, 1)) == 1;
+}
+
+template<class TexelType>
+inline size_t PooledRenderer<TexelType>::RenderBatch(std::span<const fisk::tools::V2ui> aUVs)
+{
+	size_t count = std::min(aUVs.size(), myMaxPending - std::min(myPending, myMaxPending));
+
+	for (size_t start = 0; start < count; start += TexelsPerTask)
+	{
+		std::span<const fisk::tools::V2ui> chunk = aUVs.subspan(start, std::min(TexelsPerTask, count - start));
+
+		myInFlight->fetch_add(1, std::memory_order_relaxed);
+
+		myPool.Submit(
+			[this, inFlight = myInFlight, uvs = std::vector<fisk::tools::V2ui>(chunk.begin(), chunk.end())]() mutable
+			{
+				RenderTexels(std::move(uvs));
+				Leave(*inFlight);
+			},
+			chunk[0][1] / RowsPerAffinity);
+	}
+
+	myPending += count;
+
+	return count;
+}
+
+template<class TexelType>
+inline size_t PooledRenderer<TexelType>::GetResults(std::span<Result> aOut)
+{
+	size_t count = myResults.PopBulk(aOut);
+
+	myPending -= count;
+
+	return count;
+}
+
+template<class TexelType>
+inline bool PooledRenderer<TexelType>::SupportsTiles()
+{
+	return true;
+}
+
+template<class TexelType>
+inline bool PooledRenderer<TexelType>::CanRenderTile(TexelRect aRect)
+{
+	return myPending < myMaxPending;
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::RenderTile(TexelRect aRect)
+{
+	assert(myPending < myCapacity && "RenderTile called without checking CanRenderTile");
+
+	myInFlight->fetch_add(1, std::memory_order_relaxed);
+
+	myPool.Submit(
+		[this, inFlight = myInFlight, aRect]()
+		{
+			if (myIsCancelled.load(std::memory_order_relaxed))
+			{
+				Leave(*inFlight);
+				return;
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			size_t domain = LocalDomain();
+
+			TileResult result;
+			result.myRect = aRect;
+			result.myTexels.resize(aRect.Area());
+
+			myBaseRenderers[domain]->RenderTile(aRect, result.myTexels);
+
+			myTileResults.PushWait(std::move(result), [this]() { return myIsCancelled.load(std::memory_order_relaxed); });
+
+			Finish(domain, aRect.Area(), start);
+			Leave(*inFlight);
+		},
+		aRect.myOrigin[1] / RowsPerAffinity);
+
+	myPending++;
+}
+
+template<class TexelType>
+inline bool PooledRenderer<TexelType>::GetTileResult(TileResult& aOut)
+{
+	if (!myTileResults.Pop(aOut))
+		return false;
+
+	myPending--;
+
+	return true;
+}
+
+template<class TexelType>
+inline size_t PooledRenderer<TexelType>::GetPending()
+{
+	return myPending;
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::SetResultSignal(ResultSignal* aSignal)
+{
+	myResultSignal = aSignal;
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::SetMaxPending(size_t aMaxPending)
+{
+	myMaxPending = std::min(aMaxPending, myCapacity);
+}
+
+template<class TexelType>
+inline size_t PooledRenderer<TexelType>::GetRenderedTexels(size_t aDomain) const
+{
+	return myRenderedTexels[aDomain].load(std::memory_order_relaxed);
+}
+
+template<class TexelType>
+inline std::chrono::nanoseconds PooledRenderer<TexelType>::GetBusyTime() const
+{
+	return std::chrono::nanoseconds(myBusyNanoseconds.load(std::memory_order_relaxed));
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::RenderTexels(std::vector<fisk::tools::V2ui> aUVs)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t domain = LocalDomain();
+	IRenderer<TexelType>& baseRenderer = *myBaseRenderers[domain];
+
+	size_t rendered = 0;
+
+	for (fisk::tools::V2ui uv : aUVs)
+	{
+		if (myIsCancelled.load(std::memory_order_relaxed))
+			break;
+
+		if (!myResults.PushWait(Result(uv, baseRenderer.Render(uv)), [this]() { return myIsCancelled.load(std::memory_order_relaxed); }))
+			break;
+
+		rendered++;
+	}
+
+	Finish(domain, rendered, start);
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::Finish(size_t aDomain, size_t aTexels, std::chrono::steady_clock::time_point aStart)
+{
+	myRenderedTexels[aDomain].fetch_add(aTexels, std::memory_order_relaxed);
+	myBusyNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - aStart).count(), std::memory_order_relaxed);
+
+	if (ResultSignal* resultSignal = myResultSignal.load())
+		resultSignal->Notify();
+}
+
+template<class TexelType>
+inline void PooledRenderer<TexelType>::Leave(std::atomic<size_t>& aInFlight)
+{
+	if (aInFlight.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		aInFlight.notify_all();
+}
+
+template<class TexelType>
+inline size_t PooledRenderer<TexelType>::LocalDomain() const
+{
+	return myPool.CurrentDomain().value_or(0);
+}
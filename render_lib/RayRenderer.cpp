@@ -1,156 +1,125 @@
 #include "RayRenderer.h"
 
-#include "ConvertVector.h"
-#include "PartitionBy.h"
-
-#include <algorithm>
 #include <chrono>
 
-RayRenderer::RayRenderer(const Scene& aScene, IIntersector& aIntersector, size_t aSamplesPerTexel, unsigned int aRendererId)
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+RayRenderer<IntersectorType, CameraType>::RayRenderer(const Scene& aScene, IntersectorType& aIntersector, size_t aSamplesPerTexel, size_t aMinBounces, unsigned int aRendererId)
 	: myRayCaster(aScene.GetCamera())
 	, myIntersector(aIntersector)
 	, mySky(aScene.GetSky())
 	, mySamplesPerTexel(aSamplesPerTexel)
+	, myMinBounces(aMinBounces)
 	, myRendererId(aRendererId)
 {
 }
 
-RayRenderer::Result RayRenderer::Render(fisk::tools::V2ui aUV) const
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+typename RayRenderer<IntersectorType, CameraType>::Result RayRenderer<IntersectorType, CameraType>::Render(fisk::tools::V2ui aUV) const
 {
 	Result out;
 
-	using clock = std::chrono::high_resolution_clock;
-	clock::time_point start = clock::now();
-
-	std::vector<Sample> samples;
+	std::vector<path_tracing::Sample> samples;
 	samples.reserve(mySamplesPerTexel);
 
-	for (size_t i = 0; i < mySamplesPerTexel; i++)
-		samples.push_back(SampleTexel(aUV));
+	path_tracing::Statistics statistics;
 
-	fisk::tools::V3f& color = std::get<ColorChannel>(out);
+	RenderTexel(aUV, samples, statistics, out);
 
-	for (size_t i = 0; i < mySamplesPerTexel; i++)
-		color += samples[i].myColor;
+	myStatistics.Add(statistics);
 
-	color /= static_cast<float>(mySamplesPerTexel);
+	return out;
+}
 
-	color = {
-		std::pow(color[0] / 255.f, 2.2f),
-		std::pow(color[1] / 255.f, 2.2f),
-		std::pow(color[2] / 255.f, 2.2f)
-	};
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+void RayRenderer<IntersectorType, CameraType>::RenderTile(TexelRect aRect, std::span<Result> aOut) const
+{
+	using clock = std::chrono::high_resolution_clock;
+	clock::time_point start = clock::now();
 
-	std::vector<unsigned int> objectsHit;
+	thread_local std::vector<fisk::tools::Ray<float, 3>> rays;
+	thread_local std::vector<path_tracing::Sample> samples;
 
-	{
-		objectsHit.resize(samples.size());
-		auto corutine = ConvertVectorsAsync(
-			[](const Sample& aSample)
-			{
-				return aSample.myObjectId;
-			},
-			objectsHit,
-			std::chrono::hours(1),
-			samples);
-
-		while (!corutine.done())
-			corutine.resume();
-
-		corutine.destroy();
-	}
+	rays.resize(mySamplesPerTexel);
+	samples.resize(aOut.size() * mySamplesPerTexel);
 
-	std::sort(objectsHit.begin(), objectsHit.end());
+	path_tracing::Statistics statistics;
 
-	std::vector<std::vector<unsigned int>> buckets = PartitionBy(objectsHit, [](unsigned int aLeft, unsigned int aRight)
+	for (size_t i = 0; i < aOut.size(); i++)
 	{
-		return aLeft != aRight;
-	});
-
-	unsigned int mostHit = 0;
-	size_t hits = 0;
+		myRayCaster.RenderBatch(aRect.At(i), rays);
 
-	for (auto& bucket : buckets)
-	{
-		if (bucket.size() > hits)
-		{
-			mostHit = bucket[0];
-			hits = bucket.size();
-		}
+		for (size_t sample = 0; sample < mySamplesPerTexel; sample++)
+			samples[i * mySamplesPerTexel + sample] = SampleTexel(rays[sample], statistics);
 	}
 
-	std::vector<Sample> hitsMainObject;
-	hitsMainObject.reserve(mySamplesPerTexel);
+	myStatistics.Add(statistics);
 
-	std::copy_if(samples.begin(), samples.end(), std::back_inserter(hitsMainObject), [mostHit](const Sample& aSample)
-	{
-		return aSample.myObjectId == mostHit;
-	});
+	// resolved together so the per texel bookkeeping is paid once per tile
+	path_tracing::ResolveTile(samples, mySamplesPerTexel, aOut);
 
+	// the texels are traced together, so they all get the same share of the time
+	CompactNanoSecond time = (clock::now() - start) / samples.size();
 
+	for (Result& texel : aOut)
 	{
-		objectsHit.resize(hitsMainObject.size());
-		auto corutine = ConvertVectorsAsync(
-			[](const Sample& aSample)
-			{
-				return aSample.mySubObjectId;
-			},
-			objectsHit,
-			std::chrono::hours(1),
-			hitsMainObject);
-
-		while (!corutine.done())
-			corutine.resume();
-
-		corutine.destroy();
+		std::get<TimeChannel>(texel) = time;
+		std::get<RendererChannel>(texel) = myRendererId;
 	}
+}
 
-	std::sort(objectsHit.begin(), objectsHit.end());
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+void RayRenderer<IntersectorType, CameraType>::RenderTexel(fisk::tools::V2ui aUV, std::vector<path_tracing::Sample>& aSamples, path_tracing::Statistics& aInOutStatistics, Result& aOut) const
+{
+	using clock = std::chrono::high_resolution_clock;
+	clock::time_point start = clock::now();
 
-	std::vector<std::vector<unsigned int>> subHitBuckets = PartitionBy(objectsHit, [](unsigned int aLeft, unsigned int aRight)
-	{
-		return aLeft != aRight;
-	});
+	thread_local std::vector<fisk::tools::Ray<float, 3>> rays;
 
-	unsigned int mostHitSubObject = 0;
-	size_t subHits = 0;
+	rays.resize(mySamplesPerTexel);
+	myRayCaster.RenderBatch(aUV, rays);
 
-	for (auto& bucket : subHitBuckets)
-	{
-		if (bucket.size() > subHits)
-		{
-			mostHitSubObject = bucket[0];
-			subHits = bucket.size();
-		}
-	}
+	aSamples.clear();
 
+	for (size_t i = 0; i < mySamplesPerTexel; i++)
+		aSamples.push_back(SampleTexel(rays[i], aInOutStatistics));
 
-	std::get<ObjectIdChannel>(out) = mostHit;
-	std::get<SubObjectIdChannel>(out) = mostHitSubObject;
+	path_tracing::ResolveSamples(aSamples, aOut);
 
-	std::get<TimeChannel>(out) = (clock::now() - start) / mySamplesPerTexel;
-	std::get<RendererChannel>(out) = myRendererId;
+	std::get<TimeChannel>(aOut) = (clock::now() - start) / mySamplesPerTexel;
+	std::get<RendererChannel>(aOut) = myRendererId;
+}
 
-	return out;
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+const path_tracing::StatisticsCounter& RayRenderer<IntersectorType, CameraType>::GetStatistics() const
+{
+	return myStatistics;
 }
 
-RayRenderer::Sample RayRenderer::SampleTexel(fisk::tools::V2ui aUV) const
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType>
+path_tracing::Sample RayRenderer<IntersectorType, CameraType>::SampleTexel(fisk::tools::Ray<float, 3> aRay, path_tracing::Statistics& aInOutStatistics) const
 {
-	Sample out;
+	path_tracing::Sample out;
+
+	fisk::tools::Ray<float, 3> ray = aRay;
+	fisk::tools::V3f throughput{ 1, 1, 1 };
+
+	std::optional<fisk::tools::V3f> diffuseNormal; // set when the last bounce was diffuse, needed for MIS on escape
 
-	fisk::tools::Ray<float, 3> ray = myRayCaster.Render(aUV);
+	aInOutStatistics.myPaths++;
 
-	for (size_t i = 0; i < MaxBounces; i++)
+	for (size_t i = 0; i < path_tracing::MaxBounces; i++)
 	{
+		aInOutStatistics.mySegments++;
+
 		std::optional<Hit> hit = myIntersector.Intersect(ray);
 
 		if (!hit)
 		{
-			mySky.BlendWith(out.myColor, ray);
+			out.myColor += throughput * path_tracing::EscapeRadiance(mySky, ray.myDirection, diffuseNormal);
 			break;
 		}
 
-		hit->myMaterial->InteractWith(ray, *hit, out.myColor);
+		Material::Interaction interaction = hit->myMaterial->InteractWith(ray, *hit, throughput);
 
 		if (out.myObjectId == 0)
 		{
@@ -158,7 +127,26 @@ RayRenderer::Sample RayRenderer::SampleTexel(fisk::tools::V2ui aUV) const
 			out.mySubObjectId = hit->mySubObjectId;
 		}
 
+		diffuseNormal.reset();
+
+		if (interaction == Material::Interaction::Diffuse)
+		{
+			std::optional<path_tracing::SunSample> sun = path_tracing::SampleSun(mySky, *hit);
+
+			if (sun && !myIntersector.Occluded(sun->myShadowRay))
+				out.myColor += throughput * sun->myRadiance;
+
+			diffuseNormal = hit->myNormal;
+		}
+
+		if (i + 1 >= myMinBounces && !path_tracing::SurvivesRoulette(throughput))
+		{
+			aInOutStatistics.myTerminated++;
+			break;
+		}
 	}
 
 	return out;
 }
+
+template class RayRenderer<ClusteredIntersector, Camera>;
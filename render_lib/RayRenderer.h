@@ -2,36 +2,50 @@
 
 #include "tools/Shapes.h"
 
+#include "Camera.h"
 #include "Scene.h"
 #include "IRenderer.h"
 #include "RendererTypes.h"
 #include "IIntersector.h"
+#include "PathTracing.h"
+#include "RaytracerConcept.h"
 #include "Sky.h"
 
+#include "intersectors/ClusteredIntersector.h"
+
+#include <span>
+#include <vector>
+
+/// Specialized on the concrete intersector and camera so the whole bounce loop can be inlined, the camera's batch
+/// ray generation is inline in Camera.h for the same reason. The definitions live in RayRenderer.cpp and are only
+/// instantiated for RayRenderer<ClusteredIntersector, Camera>, the one render_node uses
+/// WavefrontRenderer is not specialized and still goes through IIntersector
+template<RayIntersector IntersectorType, PrimaryRayGenerator CameraType = Camera>
 class RayRenderer : public IRenderer<TextureType::PackedValues>
 {
 public:
-	static constexpr size_t MaxBounces = 16;
-	using RayCaster = IRenderer<fisk::tools::Ray<float, 3>>;
+	using RayCaster = CameraType;
 
-	RayRenderer(const Scene& aScene, IIntersector& aIntersector, size_t aSamplesPerTexel, unsigned int aRendererId);
+	RayRenderer(const Scene& aScene, IntersectorType& aIntersector, size_t aSamplesPerTexel, size_t aMinBounces, unsigned int aRendererId);
 
 	Result Render(fisk::tools::V2ui aUV) const override;
+	void RenderTile(TexelRect aRect, std::span<Result> aOut) const override;
 
-private:
+	const path_tracing::StatisticsCounter& GetStatistics() const;
 
-	struct Sample
-	{
-		fisk::tools::V3f myColor{ 1, 1, 1 };
-		unsigned int myObjectId = 0;
-		unsigned int mySubObjectId = 0;
-	};
+private:
 
-	Sample SampleTexel(fisk::tools::V2ui aUV) const;
+	void RenderTexel(fisk::tools::V2ui aUV, std::vector<path_tracing::Sample>& aSamples, path_tracing::Statistics& aInOutStatistics, Result& aOut) const;
+	path_tracing::Sample SampleTexel(fisk::tools::Ray<float, 3> aRay, path_tracing::Statistics& aInOutStatistics) const;
 
 	const RayCaster& myRayCaster;
-	IIntersector& myIntersector;
+	IntersectorType& myIntersector;
 	const Sky& mySky;
 	size_t mySamplesPerTexel;
+	size_t myMinBounces;
 	unsigned int myRendererId;
-};
\ No newline at end of file
+
+	mutable path_tracing::StatisticsCounter myStatistics;
+};
+
+extern template class RayRenderer<ClusteredIntersector, Camera>;
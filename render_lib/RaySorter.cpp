@@ -0,0 +1,79 @@
+#include "RaySorter.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	constexpr uint32_t MortonAxisBits = 10;
+	constexpr uint32_t MortonAxisMax = (1 << MortonAxisBits) - 1;
+	constexpr uint32_t IndexBits = 31;
+}
+
+RaySorter::RaySorter(const fisk::tools::AxisAlignedBox<float, 3>& aBounds)
+{
+	myMin = aBounds.myMin;
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		float extent = aBounds.myMax[axis] - aBounds.myMin[axis];
+		myScale[axis] = extent > 0.f ? static_cast<float>(MortonAxisMax) / extent : 0.f;
+	}
+}
+
+void RaySorter::Sort(std::span<const fisk::tools::Ray<float, 3>> aRays, std::vector<uint32_t>& aOutOrder) const
+{
+	assert(aRays.size() < (uint64_t(1) << IndexBits));
+
+	thread_local std::vector<uint64_t> keys;
+
+	keys.resize(aRays.size());
+
+	// the 33 bit key goes in the high bits and the index in the low ones so a plain integer sort does the job
+	for (uint32_t i = 0; i < aRays.size(); i++)
+		keys[i] = (Key(aRays[i]) << IndexBits) | i;
+
+	std::sort(keys.begin(), keys.end());
+
+	aOutOrder.resize(aRays.size());
+
+	for (size_t i = 0; i < keys.size(); i++)
+		aOutOrder[i] = static_cast<uint32_t>(keys[i] & ((uint64_t(1) << IndexBits) - 1));
+}
+
+uint64_t RaySorter::Key(const fisk::tools::Ray<float, 3>& aRay) const
+{
+	uint32_t cell[3];
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		float scaled = (aRay.myOrigin[axis] - myMin[axis]) * myScale[axis];
+		cell[axis] = static_cast<uint32_t>(std::clamp(scaled, 0.f, static_cast<float>(MortonAxisMax)));
+	}
+
+	return (static_cast<uint64_t>(Octant(aRay.myDirection)) << (MortonAxisBits * 3)) | Morton(cell[0], cell[1], cell[2]);
+}
+
+uint32_t RaySorter::Octant(const fisk::tools::V3f& aDirection)
+{
+	return (aDirection[0] < 0.f ? 1 : 0)
+		| (aDirection[1] < 0.f ? 2 : 0)
+		| (aDirection[2] < 0.f ? 4 : 0);
+}
+
+uint32_t RaySorter::Morton(uint32_t aX, uint32_t aY, uint32_t aZ)
+{
+	return SpreadBits(aX) | (SpreadBits(aY) << 1) | (SpreadBits(aZ) << 2);
+}
+
+uint32_t RaySorter::SpreadBits(uint32_t aValue)
+{
+	aValue &= MortonAxisMax;
+
+	aValue = (aValue | (aValue << 16)) & 0x030000FF;
+	aValue = (aValue | (aValue << 8)) & 0x0300F00F;
+	aValue = (aValue | (aValue << 4)) & 0x030C30C3;
+	aValue = (aValue | (aValue << 2)) & 0x09249249;
+
+	return aValue;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "tools/Shapes.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Orders rays so that rays heading the same way from nearby origins are traced next to each other,
+/// keys are the direction octant followed by a 30 bit morton code of the origin inside the scene bounds
+class RaySorter
+{
+public:
+	RaySorter() = default;
+	RaySorter(const fisk::tools::AxisAlignedBox<float, 3>& aBounds);
+
+	/// Writes a permutation of [0, aRays.size()) into aOutOrder, aOutOrder[i] is the ray to trace i:th
+	void Sort(std::span<const fisk::tools::Ray<float, 3>> aRays, std::vector<uint32_t>& aOutOrder) const;
+
+	uint64_t Key(const fisk::tools::Ray<float, 3>& aRay) const;
+
+	static uint32_t Octant(const fisk::tools::V3f& aDirection);
+	static uint32_t Morton(uint32_t aX, uint32_t aY, uint32_t aZ);
+
+private:
+	static uint32_t SpreadBits(uint32_t aValue);
+
+	fisk::tools::V3f myMin{ 0, 0, 0 };
+	fisk::tools::V3f myScale{ 1, 1, 1 };
+};
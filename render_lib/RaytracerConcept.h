@@ -1,10 +1,31 @@
 #pragma once
 
+#include "tools/MathVector.h"
+#include "tools/Shapes.h"
+
+#include "Hit.h"
 
 #include <concepts>
+#include <optional>
+#include <span>
 
 template<class OriginalValue, class Mutator, class OutValue>
 concept CanMutateInto = requires(OriginalValue val, Mutator mut, OutValue out)
 {
 	{ mut(val) } ->std::convertible_to<OutValue>;
-};
\ No newline at end of file
+};
+
+/// Anything that can answer closest-hit and any-hit queries, IIntersector and every intersector deriving from it qualify
+template<class Intersector>
+concept RayIntersector = requires(Intersector intersector, fisk::tools::Ray<float, 3> ray)
+{
+	{ intersector.Intersect(ray) } -> std::convertible_to<std::optional<Hit>>;
+	{ intersector.Occluded(ray) } -> std::convertible_to<bool>;
+};
+
+/// Generates the jittered primary rays of a texel
+template<class Generator>
+concept PrimaryRayGenerator = requires(const Generator generator, fisk::tools::V2ui uv, std::span<fisk::tools::Ray<float, 3>> rays)
+{
+	generator.RenderBatch(uv, rays);
+};
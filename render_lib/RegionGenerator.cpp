@@ -1,13 +1,32 @@
 #include "RegionGenerator.h"
 #include "imgui/imgui.h"
 
+#include <algorithm>
+
 fisk::tools::V2ui RegionGenerator::Get()
 {
 	return myAtPostion;
 }
 
+TexelRect RegionGenerator::GetTile()
+{
+	return {
+		myAtPostion,
+		{
+			std::min(myTileSize[0], mySize[0] - myAtPostion[0]),
+			std::min(myTileSize[1], mySize[1] - myAtPostion[1])
+		}
+	};
+}
+
 RegionGenerator::RegionGenerator(fisk::tools::V2ui aSize)
+	: RegionGenerator(aSize, { 1, 1 })
+{
+}
+
+RegionGenerator::RegionGenerator(fisk::tools::V2ui aSize, fisk::tools::V2ui aTileSize)
 	: mySize(aSize)
+	, myTileSize(aTileSize)
 	, myAtPostion{ 0, 0 }
 {
 }
@@ -17,14 +36,14 @@ bool RegionGenerator::Next()
 	if (Done())
 		return false;
 
-	myAtPostion[0]++;
+	myAtPostion[0] += myTileSize[0];
 
-	if (myAtPostion[0] == mySize[0])
+	if (myAtPostion[0] >= mySize[0])
 	{
 		myAtPostion[0] = 0;
-		myAtPostion[1]++;
+		myAtPostion[1] += myTileSize[1];
 
-		if (myAtPostion[1] == mySize[1])
+		if (myAtPostion[1] >= mySize[1])
 			return false;
 
 		return true;
@@ -36,7 +55,7 @@ bool RegionGenerator::Next()
 
 bool RegionGenerator::Done()
 {
-	if (myAtPostion[1] == mySize[1])
+	if (myAtPostion[1] >= mySize[1])
 		return true;
 
 	return false;
@@ -2,6 +2,8 @@
 
 #include "tools/MathVector.h"
 
+#include "TexelRect.h"
+
 #include <string>
 
 class RegionGenerator
@@ -9,17 +11,22 @@ class RegionGenerator
 public:
 	RegionGenerator(fisk::tools::V2ui aSize);
 
+	/// Steps a tile at a time, tiles along the right and bottom edge are clipped to the size
+	RegionGenerator(fisk::tools::V2ui aSize, fisk::tools::V2ui aTileSize);
+
 	RegionGenerator(const RegionGenerator&) = default;
 	RegionGenerator& operator=(const RegionGenerator&) = default;
 	RegionGenerator(RegionGenerator&&) = default;
 	RegionGenerator& operator=(RegionGenerator&&) = default;
 	
 	fisk::tools::V2ui Get();
+	TexelRect GetTile();
 	bool Done();
 	bool Next();
 
 private:
 	fisk::tools::V2ui mySize;
+	fisk::tools::V2ui myTileSize;
 
 	fisk::tools::V2ui myAtPostion;
 };
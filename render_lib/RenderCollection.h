@@ -2,18 +2,33 @@
 
 #include "IRenderer.h"
 #include "RendererTypes.h"
-#include "tools/Iterators.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
 #include <memory>
+#include <random>
+#include <span>
 #include <vector>
 
 template<class TexelType>
 class RenderCollection : public IAsyncRenderer<TexelType>
 {
-public: 
+public:
 	using CollectionType = std::vector<std::unique_ptr<IAsyncRenderer<TexelType>>>;
 
+	/// How work is spread over the sub renderers
+	enum class DispatchPolicy
+	{
+		RoundRobin,
+		LeastOutstanding,	// fewest texels in flight
+		PowerOfTwoChoices,	// fewest in flight out of two picked at random, cheap with many renderers
+		ThroughputWeighted	// shortest expected wait given the measured completion rate, for mixing fast and slow backends
+	};
+
 	RenderCollection(CollectionType&& aCollection);
+	RenderCollection(CollectionType&& aCollection, DispatchPolicy aPolicy);
 
 
 	bool CanRender(fisk::tools::V2ui aUV) override;
@@ -21,22 +36,76 @@ public:
 	void Render(fisk::tools::V2ui aUV) override;
 	bool GetResult(IAsyncRenderer<TexelType>::Result& aOut) override;
 
+	size_t RenderBatch(std::span<const fisk::tools::V2ui> aUVs) override;
+	size_t GetResults(std::span<typename IAsyncRenderer<TexelType>::Result> aOut) override;
+
+	bool SupportsTiles() override;
+
+	bool CanRenderTile(TexelRect aRect) override;
+	void RenderTile(TexelRect aRect) override;
+	bool GetTileResult(IAsyncRenderer<TexelType>::TileResult& aOut) override;
+
 	size_t GetPending() override;
 
+	void SetResultSignal(ResultSignal* aSignal) override;
+
 	void Update() override;
 
+	DispatchPolicy GetPolicy() const;
+	void SetPolicy(DispatchPolicy aPolicy);
+
+	/// Completed texels per second of a sub renderer, as a moving average
+	float GetThroughput(size_t aIndex) const;
+
 private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t NoRenderer = std::numeric_limits<size_t>::max();
+	static constexpr size_t ChunkSize = 16;						// texels handed to one renderer at a time by the load aware policies
+	static constexpr float ThroughputSmoothing = 0.2f;
+	static constexpr std::chrono::milliseconds ThroughputInterval{ 50 };
+
+	struct Load
+	{
+		size_t myOutstanding = 0;
+		size_t myCompletedSinceSample = 0;
+		float myThroughput = 1.f;	// texels per second, starts equal for everyone until measured
+	};
+
+	/// Index of the renderer the policy prefers among the ones aAccepts is true for, or NoRenderer
+	/// Every policy looks at each renderer at most once so a collection where nothing accepts is not spun on
+	template<class Accepts>
+	size_t Pick(Accepts&& aAccepts);
+
+	void Submitted(size_t aIndex, size_t aCount);
+	void Completed(size_t aIndex, size_t aCount);
+	void SampleThroughput();
 
 	CollectionType myRenderers;
-	fisk::tools::LoopingPointer<typename CollectionType::iterator> myNext; // member order important
+	std::vector<Load> myLoads;
+	DispatchPolicy myPolicy;
+
+	size_t myNext;
 	size_t myPending;
+
+	std::minstd_rand myRandom;
+	Clock::time_point myLastSample;
 };
 
 template<class TexelType>
 inline RenderCollection<TexelType>::RenderCollection(CollectionType&& aCollection)
+	: RenderCollection(std::move(aCollection), DispatchPolicy::RoundRobin)
+{
+}
+
+template<class TexelType>
+inline RenderCollection<TexelType>::RenderCollection(CollectionType&& aCollection, DispatchPolicy aPolicy)
 	: myRenderers(std::move(aCollection))
-	, myNext(myRenderers.begin(), myRenderers.size())
+	, myLoads(myRenderers.size())
+	, myPolicy(aPolicy)
+	, myNext(0)
 	, myPending(0)
+	, myLastSample(Clock::now())
 {
 }
 
@@ -55,29 +124,153 @@ inline bool RenderCollection<TexelType>::CanRender(fisk::tools::V2ui aUV)
 template<class TexelType>
 inline void RenderCollection<TexelType>::Render(fisk::tools::V2ui aUV)
 {
-	fisk::tools::LoopingPointer<typename CollectionType::iterator> start = myNext;
+	size_t index = Pick([this, aUV](size_t aIndex) { return myRenderers[aIndex]->CanRender(aUV); });
+
+	if (index == NoRenderer)
+	{
+		assert(false && "Render called without checking CanRender");
+		return;
+	}
+
+	myRenderers[index]->Render(aUV);
+	Submitted(index, 1);
+}
+
+template<class TexelType>
+inline bool RenderCollection<TexelType>::GetResult(IAsyncRenderer<TexelType>::Result& aOut)
+{
+	return GetResults(std::span<typename IAsyncRenderer<TexelType>::Result>(&aOut, 1)) == 1;
+}
+
+template<class TexelType>
+inline size_t RenderCollection<TexelType>::RenderBatch(std::span<const fisk::tools::V2ui> aUVs)
+{
+	size_t count = 0;
+
+	if (myPolicy == DispatchPolicy::RoundRobin)
+	{
+		// one call per renderer and round, every renderer is offered an even share of what is left
+		while (count < aUVs.size())
+		{
+			size_t acceptedThisRound = 0;
+
+			for (size_t i = 0; i < myRenderers.size() && count < aUVs.size(); i++)
+			{
+				size_t renderersLeft = myRenderers.size() - i;
+				size_t remaining = aUVs.size() - count;
+				size_t share = (remaining + renderersLeft - 1) / renderersLeft;
+
+				size_t accepted = myRenderers[myNext]->RenderBatch(aUVs.subspan(count, share));
+				Submitted(myNext, accepted);
+
+				count += accepted;
+				acceptedThisRound += accepted;
+
+				myNext = (myNext + 1) % myRenderers.size();
+			}
+
+			if (acceptedThisRound == 0)
+				break;
+		}
+
+		return count;
+	}
+
+	// the load aware policies are asked again for every chunk, so the counts they go by stay current
+	std::vector<bool> full(myRenderers.size(), false);
+
+	while (count < aUVs.size())
+	{
+		size_t index = Pick([&full](size_t aIndex) { return !full[aIndex]; });
+
+		if (index == NoRenderer)
+			break;
+
+		size_t chunk = std::min(ChunkSize, aUVs.size() - count);
+		size_t accepted = myRenderers[index]->RenderBatch(aUVs.subspan(count, chunk));
+
+		Submitted(index, accepted);
+		count += accepted;
+
+		if (accepted < chunk)
+			full[index] = true;
+	}
+
+	return count;
+}
+
+template<class TexelType>
+inline size_t RenderCollection<TexelType>::GetResults(std::span<typename IAsyncRenderer<TexelType>::Result> aOut)
+{
+	size_t count = 0;
 
-	while(!(**myNext).CanRender(aUV))
+	for (size_t i = 0; i < myRenderers.size() && count < aOut.size(); i++)
 	{
-		++myNext;
+		size_t got = myRenderers[i]->GetResults(aOut.subspan(count));
 
-		//assert(myNext == start); convestions make this assert weird
+		Completed(i, got);
+		count += got;
 	}
 
-	(**myNext).Render(aUV);
-	myNext++;
+	SampleThroughput();
 
-	myPending++;
+	return count;
 }
 
 template<class TexelType>
-inline bool RenderCollection<TexelType>::GetResult(IAsyncRenderer<TexelType>::Result& aOut)
+inline bool RenderCollection<TexelType>::SupportsTiles()
 {
 	for (std::unique_ptr<IAsyncRenderer<TexelType>>& renderer : myRenderers)
 	{
-		if (renderer->GetResult(aOut))
+		if (!renderer->SupportsTiles())
+			return false;
+	}
+
+	return !myRenderers.empty();
+}
+
+template<class TexelType>
+inline bool RenderCollection<TexelType>::CanRenderTile(TexelRect aRect)
+{
+	for (std::unique_ptr<IAsyncRenderer<TexelType>>& renderer : myRenderers)
+	{
+		if (renderer->CanRenderTile(aRect))
+			return true;
+	}
+
+	return false;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::RenderTile(TexelRect aRect)
+{
+	size_t index = Pick([this, aRect](size_t aIndex) { return myRenderers[aIndex]->CanRenderTile(aRect); });
+
+	if (index == NoRenderer)
+	{
+		assert(false && "RenderTile called without checking CanRenderTile");
+		return;
+	}
+
+	myRenderers[index]->RenderTile(aRect);
+
+	// the load is in texels so a tile weighs as much as its texels would, but it is a single pending job
+	myLoads[index].myOutstanding += aRect.Area();
+	myPending++;
+}
+
+template<class TexelType>
+inline bool RenderCollection<TexelType>::GetTileResult(IAsyncRenderer<TexelType>::TileResult& aOut)
+{
+	for (size_t i = 0; i < myRenderers.size(); i++)
+	{
+		if (myRenderers[i]->GetTileResult(aOut))
 		{
+			myLoads[i].myOutstanding -= aOut.myRect.Area();
+			myLoads[i].myCompletedSinceSample += aOut.myRect.Area();
 			myPending--;
+
+			SampleThroughput();
 			return true;
 		}
 	}
@@ -87,7 +280,14 @@ inline bool RenderCollection<TexelType>::GetResult(IAsyncRenderer<TexelType>::Re
 template<class TexelType>
 inline size_t RenderCollection<TexelType>::GetPending()
 {
-	return size_t();
+	return myPending;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::SetResultSignal(ResultSignal* aSignal)
+{
+	for (std::unique_ptr<IAsyncRenderer<TexelType>>& renderer : myRenderers)
+		renderer->SetResultSignal(aSignal);
 }
 
 template<class TexelType>
@@ -96,3 +296,141 @@ inline void RenderCollection<TexelType>::Update()
 	for (std::unique_ptr<IAsyncRenderer<TexelType>>& renderer : myRenderers)
 		renderer->Update();
 }
+
+template<class TexelType>
+inline RenderCollection<TexelType>::DispatchPolicy RenderCollection<TexelType>::GetPolicy() const
+{
+	return myPolicy;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::SetPolicy(DispatchPolicy aPolicy)
+{
+	myPolicy = aPolicy;
+}
+
+template<class TexelType>
+inline float RenderCollection<TexelType>::GetThroughput(size_t aIndex) const
+{
+	return myLoads[aIndex].myThroughput;
+}
+
+template<class TexelType>
+template<class Accepts>
+inline size_t RenderCollection<TexelType>::Pick(Accepts&& aAccepts)
+{
+	const size_t count = myRenderers.size();
+
+	switch (myPolicy)
+	{
+	case DispatchPolicy::RoundRobin:
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t index = (myNext + i) % count;
+
+			if (aAccepts(index))
+			{
+				myNext = (index + 1) % count;
+				return index;
+			}
+		}
+		return NoRenderer;
+
+	case DispatchPolicy::PowerOfTwoChoices:
+		if (count > 2)
+		{
+			size_t first = myRandom() % count;
+			size_t second = (first + 1 + myRandom() % (count - 1)) % count;
+
+			if (myLoads[second].myOutstanding < myLoads[first].myOutstanding)
+				std::swap(first, second);
+
+			if (aAccepts(first))
+				return first;
+
+			if (aAccepts(second))
+				return second;
+		}
+		[[fallthrough]]; // both picks were full, or there are too few renderers for random picks to matter
+
+	case DispatchPolicy::LeastOutstanding:
+	{
+		size_t best = NoRenderer;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (best != NoRenderer && myLoads[i].myOutstanding >= myLoads[best].myOutstanding)
+				continue;
+
+			if (aAccepts(i))
+				best = i;
+		}
+
+		return best;
+	}
+
+	case DispatchPolicy::ThroughputWeighted:
+	{
+		size_t best = NoRenderer;
+		float bestWait = std::numeric_limits<float>::max();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// time until a texel queued here now would be done
+			float wait = static_cast<float>(myLoads[i].myOutstanding + 1) / std::max(myLoads[i].myThroughput, 0.001f);
+
+			if (wait >= bestWait)
+				continue;
+
+			if (aAccepts(i))
+			{
+				best = i;
+				bestWait = wait;
+			}
+		}
+
+		return best;
+	}
+	}
+
+	return NoRenderer;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::Submitted(size_t aIndex, size_t aCount)
+{
+	myLoads[aIndex].myOutstanding += aCount;
+	myPending += aCount;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::Completed(size_t aIndex, size_t aCount)
+{
+	myLoads[aIndex].myOutstanding -= aCount;
+	myLoads[aIndex].myCompletedSinceSample += aCount;
+	myPending -= aCount;
+}
+
+template<class TexelType>
+inline void RenderCollection<TexelType>::SampleThroughput()
+{
+	Clock::time_point now = Clock::now();
+	std::chrono::duration<float> elapsed = now - myLastSample;
+
+	if (elapsed < ThroughputInterval)
+		return;
+
+	for (Load& load : myLoads)
+	{
+		// renderers with nothing in flight keep their old rate, being idle says nothing about their speed
+		if (load.myCompletedSinceSample == 0 && load.myOutstanding == 0)
+			continue;
+
+		float rate = static_cast<float>(load.myCompletedSinceSample) / elapsed.count();
+
+		load.myThroughput += (rate - load.myThroughput) * ThroughputSmoothing;
+		load.myCompletedSinceSample = 0;
+	}
+
+	myLastSample = now;
+}
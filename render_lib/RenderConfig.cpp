@@ -4,5 +4,39 @@ bool RenderConfig::Process(fisk::tools::DataProcessor& aProcessor)
 {
 	return aProcessor.Process(myMode)
 		&& aProcessor.Process(mySamplesPerTexel)
+		&& aProcessor.Process(mySamplesPerPass)
+		&& aProcessor.Process(myMinBounces)
+		&& aProcessor.Process(myRayOrdering)
+		&& aProcessor.Process(myTexelEncoding)
+		&& aProcessor.Process(myPriority)
+		&& aProcessor.Process(myResultBatchBytes)
+		&& aProcessor.Process(myResultBatchMicroseconds)
 		&& aProcessor.Process(myRenderId);
-}
\ No newline at end of file
+}
+
+bool RenderConfig::IsValid() const
+{
+	if (mySamplesPerTexel == 0)
+		return false;
+
+	return mySamplesPerTexel % GetSamplesPerPass() == 0;
+}
+
+size_t RenderConfig::GetSamplesPerPass() const
+{
+	if (mySamplesPerPass == 0 || mySamplesPerPass > mySamplesPerTexel)
+		return mySamplesPerTexel;
+
+	return mySamplesPerPass;
+}
+
+size_t RenderConfig::GetPasses() const
+{
+	size_t perPass = GetSamplesPerPass();
+
+	if (perPass == 0)
+		return 1;
+
+	// exact for valid configs
+	return mySamplesPerTexel / perPass;
+}
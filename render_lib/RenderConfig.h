@@ -8,12 +8,39 @@ struct RenderConfig
 {
 	enum RenderMode : uint32_t
 	{
-		RaytracedClustered
+		RaytracedClustered,
+		WavefrontClustered
+	};
+
+	enum RayOrdering : uint32_t
+	{
+		Unsorted,
+		SortSecondary // bucket bounced rays by direction octant and origin before intersecting them
+	};
+
+	enum TexelEncoding : uint32_t
+	{
+		FullTexels,
+		CompactTexels // see CompactTexel.h, only valid when CompactTexel::CanEncode holds for the scene
 	};
 
 	bool Process(fisk::tools::DataProcessor& aProcessor);
 
+	/// Every pass renders the same number of samples, so a samples per pass that does not divide the samples per texel
+	/// would make the last pass overshoot it and skew the average, such configs are rejected instead
+	bool IsValid() const;
+
+	size_t GetSamplesPerPass() const;
+	size_t GetPasses() const;
+
 	RenderMode myMode;
 	size_t mySamplesPerTexel;
+	size_t mySamplesPerPass = 0; // 0 renders every texel in a single pass
+	size_t myMinBounces = 3; // bounces before russian roulette may terminate a path
+	RayOrdering myRayOrdering = SortSecondary; // only used by the batched renderers
+	TexelEncoding myTexelEncoding = FullTexels; // encoding of the results sent back by the node
+	uint32_t myPriority = 1; // weight of this session's share of a node when other sessions run on it too
+	uint32_t myResultBatchBytes = 64 * 1024; // the node holds results back until a batch is this large, 0 sends whatever is done every update
+	uint32_t myResultBatchMicroseconds = 2000; // or until the oldest held result has waited this long, lower for interactive rendering
 	unsigned int myRenderId;
-};
\ No newline at end of file
+};
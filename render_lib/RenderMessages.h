@@ -0,0 +1,255 @@
+#pragma once
+
+#include "tools/DataProcessor.h"
+#include "tools/MathVector.h"
+
+#include "CompactTexel.h"
+#include "RenderConfig.h"
+#include "TexelRect.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// Work the client sends while rendering, a single texel or a whole tile
+/// The client also sends a BatchRead for every result batch it has taken off the stream, so the node knows how much
+/// it has written that the client has not caught up with
+struct RenderRequest
+{
+	enum Kind : uint8_t
+	{
+		Texel,
+		Tile,
+		BatchRead
+	};
+
+	Kind myKind = Texel;
+	TexelRect myRect; // only the origin is sent for a texel, nothing for a BatchRead
+
+	inline bool Process(fisk::tools::DataProcessor& aProcessor)
+	{
+		if (!aProcessor.Process(myKind))
+			return false;
+
+		if (myKind == BatchRead)
+		{
+			myRect = {};
+			return true;
+		}
+
+		if (!aProcessor.Process(myRect.myOrigin))
+			return false;
+
+		if (myKind == Texel)
+		{
+			myRect.mySize = { 1, 1 };
+			return true;
+		}
+
+		return aProcessor.Process(myRect.mySize);
+	}
+};
+
+/// Fixed size values go into result batches as their bytes, SystemValues is checked before anything is rendered so
+/// both ends agree on the layout. Pairs and tuples are written member by member
+namespace wire
+{
+	template<class T>
+	struct IsTupleLike : std::false_type {};
+
+	template<class... Types>
+	struct IsTupleLike<std::tuple<Types...>> : std::true_type {};
+
+	template<class First, class Second>
+	struct IsTupleLike<std::pair<First, Second>> : std::true_type {};
+
+	template<class T>
+	inline void Write(std::vector<uint8_t>& aOut, const T& aValue)
+	{
+		if constexpr (IsTupleLike<T>::value)
+		{
+			std::apply([&aOut](const auto&... aMembers) { (Write(aOut, aMembers), ...); }, aValue);
+		}
+		else
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			size_t at = aOut.size();
+			aOut.resize(at + sizeof(T));
+			std::memcpy(aOut.data() + at, &aValue, sizeof(T));
+		}
+	}
+
+	/// Returns false if aBytes ends before the value does
+	template<class T>
+	inline bool Read(std::span<const uint8_t> aBytes, size_t& aInOutAt, T& aOut)
+	{
+		if constexpr (IsTupleLike<T>::value)
+		{
+			return std::apply([aBytes, &aInOutAt](auto&... aMembers) { return (Read(aBytes, aInOutAt, aMembers) && ...); }, aOut);
+		}
+		else
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			if (aBytes.size() - aInOutAt < sizeof(T))
+				return false;
+
+			std::memcpy(&aOut, aBytes.data() + aInOutAt, sizeof(T));
+			aInOutAt += sizeof(T);
+
+			return true;
+		}
+	}
+}
+
+/// A result the node sends back, answered with the same kind as the request so texels and tiles can share the stream
+/// Tiles are packed in row major order without per texel coordinates, only the members for myKind and myEncoding are sent
+template<class TexelType>
+struct ResultMessage
+{
+	RenderRequest::Kind myKind = RenderRequest::Texel;
+	RenderConfig::TexelEncoding myEncoding = RenderConfig::FullTexels; // not sent, both ends have it from the RenderConfig
+
+	std::pair<fisk::tools::V2ui, TexelType> myTexel;
+	CompactResult myCompactTexel;
+
+	TexelRect myRect;
+	std::vector<TexelType> myTexels;
+	std::vector<CompactTexel> myCompactTexels;
+
+	size_t myMaxArea = SIZE_MAX;	// not sent, a tile larger than this is not read
+
+	inline void Write(std::vector<uint8_t>& aOut) const
+	{
+		wire::Write(aOut, myKind);
+
+		bool compact = myEncoding == RenderConfig::CompactTexels;
+
+		if (myKind == RenderRequest::Texel)
+		{
+			if (compact)
+				wire::Write(aOut, myCompactTexel);
+			else
+				wire::Write(aOut, myTexel);
+
+			return;
+		}
+
+		wire::Write(aOut, myRect);
+
+		if (compact)
+			WriteTexels(aOut, myCompactTexels);
+		else
+			WriteTexels(aOut, myTexels);
+	}
+
+	/// Returns false if the bytes at aInOutAt are not a whole valid message
+	inline bool Read(std::span<const uint8_t> aBytes, size_t& aInOutAt)
+	{
+		if (!wire::Read(aBytes, aInOutAt, myKind))
+			return false;
+
+		bool compact = myEncoding == RenderConfig::CompactTexels;
+
+		if (myKind == RenderRequest::Texel)
+			return compact ? wire::Read(aBytes, aInOutAt, myCompactTexel) : wire::Read(aBytes, aInOutAt, myTexel);
+
+		if (myKind != RenderRequest::Tile || !wire::Read(aBytes, aInOutAt, myRect))
+			return false;
+
+		if (myRect.Area() == 0 || myRect.Area() > myMaxArea)
+			return false;
+
+		return compact ? ReadTexels(aBytes, aInOutAt, myCompactTexels) : ReadTexels(aBytes, aInOutAt, myTexels);
+	}
+
+private:
+	template<class T>
+	inline void WriteTexels(std::vector<uint8_t>& aOut, const std::vector<T>& aTexels) const
+	{
+		for (const T& texel : aTexels)
+			wire::Write(aOut, texel);
+	}
+
+	template<class T>
+	inline bool ReadTexels(std::span<const uint8_t> aBytes, size_t& aInOutAt, std::vector<T>& aTexels)
+	{
+		aTexels.resize(myRect.Area());
+
+		for (T& texel : aTexels)
+		{
+			if (!wire::Read(aBytes, aInOutAt, texel))
+				return false;
+		}
+
+		return true;
+	}
+};
+
+/// Results are sent in batches so one socket write carries many of them. The messages are framed into a single
+/// contiguous buffer as the batch is built, it goes out with one Process and is read back whole, so the reader never
+/// parses a message twice waiting for the rest of it
+template<class TexelType>
+class ResultBatch
+{
+public:
+	inline void Add(const ResultMessage<TexelType>& aMessage)
+	{
+		aMessage.Write(myBytes);
+		myCount++;
+	}
+
+	/// Decodes the next message of a received batch, returns false at the end or if the rest is not a valid message
+	inline bool Next(ResultMessage<TexelType>& aOut)
+	{
+		return myReadAt < myBytes.size() && aOut.Read(myBytes, myReadAt);
+	}
+
+	/// True once Next has decoded every byte, anything left over means the batch was malformed
+	inline bool IsFullyRead() const
+	{
+		return myReadAt == myBytes.size();
+	}
+
+	inline uint32_t GetCount() const
+	{
+		return myCount;
+	}
+
+	/// Bytes the batch takes on the wire, counting the buffer's length prefix as 8
+	inline size_t GetBytes() const
+	{
+		return sizeof(myCount) + sizeof(uint64_t) + myBytes.size();
+	}
+
+	inline bool IsEmpty() const
+	{
+		return myCount == 0;
+	}
+
+	inline void Clear()
+	{
+		myCount = 0;
+		myBytes.clear();
+		myReadAt = 0;
+	}
+
+	inline bool Process(fisk::tools::DataProcessor& aProcessor)
+	{
+		myReadAt = 0;
+
+		return aProcessor.Process(myCount)
+			&& aProcessor.Process(myBytes);
+	}
+
+private:
+	uint32_t myCount = 0; // never 0 on the wire
+	std::vector<uint8_t> myBytes;
+	size_t myReadAt = 0;
+};
@@ -2,6 +2,8 @@
 #pragma once
 
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include "MultichannelTexture.h"
 
 using CompactNanoSecond = std::chrono::duration<float, std::nano>;
@@ -12,4 +14,31 @@ static constexpr size_t ColorChannel = 0;
 static constexpr size_t TimeChannel = 1;
 static constexpr size_t ObjectIdChannel = 2;
 static constexpr size_t SubObjectIdChannel = 3;
-static constexpr size_t RendererChannel = 4;
\ No newline at end of file
+static constexpr size_t RendererChannel = 4;
+
+/// Running sums for progressive rendering, divide by the sample count to get the mean
+using AccumulationTextureType = MultiChannelTexture<fisk::tools::V3f, CompactNanoSecond, uint32_t>;
+
+static constexpr size_t AccumulatedColorChannel = 0;
+static constexpr size_t AccumulatedTimeChannel = 1;
+static constexpr size_t SampleCountChannel = 2;
+
+/// Maps the averaged radiance of a texel into the range stored in the ColorChannel
+inline fisk::tools::V3f ResolveColor(fisk::tools::V3f aRadiance)
+{
+	return {
+		std::pow(aRadiance[0] / 255.f, 2.2f),
+		std::pow(aRadiance[1] / 255.f, 2.2f),
+		std::pow(aRadiance[2] / 255.f, 2.2f)
+	};
+}
+
+/// Inverse of ResolveColor, used to merge already resolved texels without biasing the mean
+inline fisk::tools::V3f UnresolveColor(fisk::tools::V3f aColor)
+{
+	return {
+		std::pow(aColor[0], 1.f / 2.2f) * 255.f,
+		std::pow(aColor[1], 1.f / 2.2f) * 255.f,
+		std::pow(aColor[2], 1.f / 2.2f) * 255.f
+	};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+/// Lets a thread sleep until an async renderer has finished something, renderers only pay for
+/// the lock when someone is actually waiting
+class ResultSignal
+{
+public:
+	/// Take this before polling for results and pass it to WaitFor, so a result finished in between is not missed
+	inline uint64_t Current() const
+	{
+		return myCount.load();
+	}
+
+	/// Called from every Notify, for waking loops that sleep on something else than WaitFor
+	/// Has to be set before the signal is handed to any renderer
+	inline void SetOnNotify(std::function<void()> aCallback)
+	{
+		myOnNotify = std::move(aCallback);
+	}
+
+	inline void Notify()
+	{
+		myCount.fetch_add(1);
+
+		if (myOnNotify)
+			myOnNotify();
+
+		if (myWaiters.load() == 0)
+			return;
+
+		std::lock_guard lock(myMutex);
+		myCondition.notify_all();
+	}
+
+	/// Returns true if something was finished after aSeen was taken
+	inline bool WaitFor(uint64_t aSeen, std::chrono::microseconds aTimeout)
+	{
+		myWaiters.fetch_add(1);
+
+		bool notified;
+		{
+			std::unique_lock lock(myMutex);
+			notified = myCondition.wait_for(lock, aTimeout, [this, aSeen]() { return myCount.load() != aSeen; });
+		}
+
+		myWaiters.fetch_sub(1);
+
+		return notified;
+	}
+
+private:
+	std::atomic<uint64_t> myCount = 0;
+	std::atomic<uint32_t> myWaiters = 0;
+
+	std::mutex myMutex;
+	std::condition_variable myCondition;
+
+	std::function<void()> myOnNotify;
+};
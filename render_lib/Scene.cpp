@@ -9,7 +9,10 @@
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 float operator ""_m(unsigned long long aValue)
 {
@@ -39,15 +42,31 @@ bool Scene::Process(fisk::tools::DataProcessor& aProcessor)
 		&& aProcessor.Process(mySky);
 }
 
-void Scene::Add(const PolyObject& aPolyObject, size_t aMaterialIndex)
+std::unique_ptr<Scene> Scene::Clone() const
+{
+	std::unique_ptr<Scene> out = std::make_unique<Scene>();
+
+	out->myMaterials.reserve(myMaterials.size());
+	for (const std::unique_ptr<Material>& material : myMaterials)
+		out->myMaterials.push_back(std::make_unique<Material>(*material));
+
+	out->myPolyObjects = myPolyObjects;
+	out->myCamera = myCamera;
+	out->mySky = mySky;
+	out->myIdCounter = myIdCounter;
+
+	return out;
+}
+
+void Scene::Add(PolyObject aPolyObject, size_t aMaterialIndex)
 {
 	SceneObject<PolyObject> scenePoly;
 
-	scenePoly.myShape = aPolyObject;
+	scenePoly.myShape = std::move(aPolyObject);
 	scenePoly.myId = ++myIdCounter;
 	scenePoly.myMaterialIndex = static_cast<unsigned int>(aMaterialIndex);
 
-	myPolyObjects.push_back(scenePoly);
+	myPolyObjects.push_back(std::move(scenePoly));
 }
 
 std::unique_ptr<Scene> Scene::FromFile(std::string aFilePath, fisk::tools::V2ui aResolution)
@@ -70,7 +89,11 @@ std::unique_ptr<Scene> Scene::FromFile(std::string aFilePath, fisk::tools::V2ui
 	}
 
 	out->ImportMaterials(scene);
-	out->ImportNode(scene, scene->mRootNode);
+
+	std::vector<MeshImport> meshes;
+	out->CollectMeshes(scene, scene->mRootNode, aiMatrix4x4(), meshes);
+	out->ImportMeshes(meshes);
+
 	out->ImportCamera(scene, aResolution);
 	out->ImportSky();
 
@@ -132,39 +155,110 @@ void Scene::ImportMaterials(const aiScene* aScene)
 	}
 }
 
-void Scene::ImportNode(const aiScene* aScene, const aiNode* aNode)
+void Scene::CollectMeshes(const aiScene* aScene, const aiNode* aNode, const aiMatrix4x4& aParentTransform, std::vector<MeshImport>& aOut)
 {
-	ImportMeshes(aScene->mMeshes, aNode);
+	// same order as FullTransform, but built once on the way down instead of walking the ancestors for every node
+	aiMatrix4x4 transform = aNode->mTransformation;
+	transform *= aParentTransform;
+
+	if (aNode->mMeshes)
+	{
+		for (unsigned int meshIndex : fisk::tools::RangeFromStartEnd(aNode->mMeshes, aNode->mMeshes + aNode->mNumMeshes))
+			aOut.push_back({ aScene->mMeshes[meshIndex], transform });
+	}
 
 	if (!aNode->mChildren)
 		return;
 
 	for (const aiNode* child : fisk::tools::RangeFromStartEnd(aNode->mChildren, aNode->mChildren + aNode->mNumChildren))
 	{
-		ImportNode(aScene, child);
+		CollectMeshes(aScene, child, transform, aOut);
 	}
 }
 
-void Scene::ImportMeshes(aiMesh*const* aMeshes, const aiNode* aNode)
+void Scene::ImportMeshes(const std::vector<MeshImport>& aMeshes)
 {
-	if (!aNode->mMeshes)
-		return;
+	// faces are converted in chunks so a single huge mesh is spread over every thread too
+	constexpr unsigned int FacesPerChunk = 16 * 1024;
+
+	struct Chunk
+	{
+		size_t myMesh;
+		unsigned int myBegin;
+		unsigned int myEnd;
+		fisk::tools::AxisAlignedBox<float, 3> myBoundingBox;
+	};
 
-	aiMatrix4x4 transform = FullTransform(aNode);
+	std::vector<PolyObject> objects(aMeshes.size());
+	std::vector<Chunk> chunks;
 
-	for (unsigned int meshIndex : fisk::tools::RangeFromStartEnd(aNode->mMeshes, aNode->mMeshes + aNode->mNumMeshes))
+	for (size_t i = 0; i < aMeshes.size(); i++)
 	{
-		const aiMesh* mesh = aMeshes[meshIndex];
+		const aiMesh* mesh = aMeshes[i].myMesh;
 
-		if (!mesh->HasFaces())
-			return;
-		
-		PolyObject obj = PolyObject::FromTri(TriFromFace(mesh->mVertices, mesh->mFaces[0], transform));
+		objects[i].myTris.resize(mesh->mNumFaces);
+
+		for (unsigned int begin = 0; begin < mesh->mNumFaces; begin += FacesPerChunk)
+			chunks.push_back({ i, begin, std::min(begin + FacesPerChunk, mesh->mNumFaces), {} });
+	}
+
+	std::atomic<size_t> nextChunk = 0;
 
-		for (const aiFace& face : fisk::tools::RangeFromStartEnd(mesh->mFaces + 1, mesh->mFaces + mesh->mNumFaces))
-			obj.AddTri(TriFromFace(mesh->mVertices, face, transform));
+	auto work = [&aMeshes, &objects, &chunks, &nextChunk]()
+	{
+		for (size_t index = nextChunk++; index < chunks.size(); index = nextChunk++)
+		{
+			Chunk& chunk = chunks[index];
+			const MeshImport& import = aMeshes[chunk.myMesh];
+			std::vector<fisk::tools::Tri<float>>& tris = objects[chunk.myMesh].myTris;
+
+			for (unsigned int face = chunk.myBegin; face < chunk.myEnd; face++)
+			{
+				fisk::tools::Tri<float> tri = TriFromFace(import.myMesh->mVertices, import.myMesh->mFaces[face], import.myTransform);
+
+				if (face == chunk.myBegin)
+				{
+					chunk.myBoundingBox.myMin = tri.myOrigin;
+					chunk.myBoundingBox.myMax = tri.myOrigin;
+				}
+
+				chunk.myBoundingBox.ExpandToInclude(tri.myOrigin);
+				chunk.myBoundingBox.ExpandToInclude(tri.myOrigin + tri.mySideA);
+				chunk.myBoundingBox.ExpandToInclude(tri.myOrigin + tri.mySideB);
+
+				tris[face] = tri;
+			}
+		}
+	};
+
+	size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunks.size());
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < threadCount; i++)
+		threads.emplace_back(work);
+
+	work();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	myPolyObjects.reserve(myPolyObjects.size() + aMeshes.size());
+
+	// chunks are in mesh order, merge their bounds and add the objects in the order the tree was walked
+	for (size_t i = 0, chunk = 0; i < aMeshes.size(); i++)
+	{
+		if (objects[i].myTris.empty())
+			continue;
+
+		objects[i].myBoundingBox = chunks[chunk].myBoundingBox;
+
+		for (; chunk < chunks.size() && chunks[chunk].myMesh == i; chunk++)
+		{
+			objects[i].myBoundingBox.ExpandToInclude(chunks[chunk].myBoundingBox.myMin);
+			objects[i].myBoundingBox.ExpandToInclude(chunks[chunk].myBoundingBox.myMax);
+		}
 
-		Add(obj, mesh->mMaterialIndex);
+		Add(std::move(objects[i]), aMeshes[i].myMesh->mMaterialIndex);
 	}
 }
 
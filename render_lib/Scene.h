@@ -41,16 +41,26 @@ public:
 
 	static std::unique_ptr<Scene> FromFile(std::string aFilePath, fisk::tools::V2ui aResolution);
 
+	/// Deep copy, the memory ends up local to the thread calling this
+	std::unique_ptr<Scene> Clone() const;
+
 private:
 
+	/// A mesh and the full transform of the node it hangs off
+	struct MeshImport
+	{
+		const aiMesh* myMesh;
+		aiMatrix4x4 myTransform;
+	};
+
 	void ImportMaterials(const aiScene* aScene);
-	void ImportNode(const aiScene* aScene, const aiNode* aNode);
-	void ImportMeshes(aiMesh* const * aMeshes, const aiNode* aNode);
+	void CollectMeshes(const aiScene* aScene, const aiNode* aNode, const aiMatrix4x4& aParentTransform, std::vector<MeshImport>& aOut);
+	void ImportMeshes(const std::vector<MeshImport>& aMeshes);
 	void ImportCamera(const aiScene* aScene, fisk::tools::V2ui aResolution);
 	void ImportSky();
 
 
-	void Add(const PolyObject& aPolyObject, size_t aMaterialIndex);
+	void Add(PolyObject aPolyObject, size_t aMaterialIndex);
 
 	static fisk::tools::Tri<float> TriFromFace(const aiVector3D* aVerticies, const aiFace& aFace, const aiMatrix4x4& aTransform);
 	static fisk::tools::V3f TranslateVectorType(const aiVector3D& aVector);
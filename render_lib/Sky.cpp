@@ -1,5 +1,8 @@
 #include "Sky.h"
 
+#include <algorithm>
+#include <numbers>
+
 
 Sky::Sky(fisk::tools::V3f aSunDirection, float aSunAngleRadius, fisk::tools::V3f aSunColor, fisk::tools::V3f aSkyColor)
 {
@@ -22,10 +25,47 @@ bool Sky::Process(fisk::tools::DataProcessor& aProcessor)
 
 void Sky::BlendWith(fisk::tools::V3f& aInOutColor, fisk::tools::Ray<float, 3> aFrom) const
 {
-	float alignment = aFrom.myDirection.Dot(mySunDirection);
+	aInOutColor *= Emission(aFrom.myDirection);
+}
+
+fisk::tools::V3f Sky::Emission(fisk::tools::V3f aDirection) const
+{
+	if (IsSun(aDirection))
+		return mySunColor;
+
+	return mySkyColor;
+}
+
+bool Sky::IsSun(fisk::tools::V3f aDirection) const
+{
+	return aDirection.Dot(mySunDirection) > mySunEdge;
+}
+
+fisk::tools::V3f Sky::SampleSunDirection(float aU, float aV) const
+{
+	fisk::tools::V3f referenceAxis{ 0, 1, 0 };
+
+	if (mySunDirection.DistanceSqr(referenceAxis) < 0.01f) // math breaks down
+		referenceAxis = { 1, 0, 0 };
+
+	fisk::tools::V3f tangent = mySunDirection.Cross(referenceAxis).GetNormalized();
+	fisk::tools::V3f bitangent = mySunDirection.Cross(tangent);
+
+	float cosTheta = 1.f - aU * (1.f - mySunEdge);
+	float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+	float phi = 2.f * std::numbers::pi_v<float> * aV;
+
+	return mySunDirection * cosTheta
+		+ tangent * (std::cos(phi) * sinTheta)
+		+ bitangent * (std::sin(phi) * sinTheta);
+}
+
+float Sky::SunPdf() const
+{
+	return 1.f / (2.f * std::numbers::pi_v<float> * (1.f - mySunEdge));
+}
 
-	if (alignment > mySunEdge)
-		aInOutColor *= mySunColor;
-	else
-		aInOutColor *= mySkyColor;
+fisk::tools::V3f Sky::GetSunColor() const
+{
+	return mySunColor;
 }
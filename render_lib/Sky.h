@@ -14,6 +14,17 @@ public:
 
 	void BlendWith(fisk::tools::V3f& aInOutColor, fisk::tools::Ray<float, 3> aFrom) const;
 
+	fisk::tools::V3f Emission(fisk::tools::V3f aDirection) const;
+	bool IsSun(fisk::tools::V3f aDirection) const;
+
+	/// Uniformly samples a direction inside the sun disc from two uniform [0, 1) values
+	fisk::tools::V3f SampleSunDirection(float aU, float aV) const;
+
+	/// Solid angle density of SampleSunDirection
+	float SunPdf() const;
+
+	fisk::tools::V3f GetSunColor() const;
+
 private:
 
 	fisk::tools::V3f mySunDirection;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "tools/DataProcessor.h"
+#include "tools/MathVector.h"
+
+#include <cstddef>
+
+/// A rectangle of texels, texels inside are addressed in row major order
+struct TexelRect
+{
+	fisk::tools::V2ui myOrigin;
+	fisk::tools::V2ui mySize;
+
+	inline size_t Area() const
+	{
+		return static_cast<size_t>(mySize[0]) * mySize[1];
+	}
+
+	inline fisk::tools::V2ui At(size_t aIndex) const
+	{
+		return {
+			myOrigin[0] + static_cast<unsigned int>(aIndex % mySize[0]),
+			myOrigin[1] + static_cast<unsigned int>(aIndex / mySize[0])
+		};
+	}
+
+	inline bool Process(fisk::tools::DataProcessor& aProcessor)
+	{
+		return aProcessor.Process(myOrigin)
+			&& aProcessor.Process(mySize);
+	}
+};
@@ -0,0 +1,237 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+	thread_local const ThreadPool* LocalPool = nullptr;
+	thread_local size_t LocalWorker = 0;
+}
+
+ThreadPool::ThreadPool(size_t aThreadCount)
+	: myNextWorker(0)
+	, mySignal(0)
+	, myIsStopping(false)
+{
+	if (aThreadCount == 0)
+		aThreadCount = 1;
+
+	myWorkers.reserve(aThreadCount);
+	myDomainWorkers.emplace_back();
+	myDomainCpus.emplace_back();
+
+	for (size_t i = 0; i < aThreadCount; i++)
+	{
+		myWorkers.push_back(std::make_unique<Worker>());
+		myDomainWorkers[0].push_back(i);
+	}
+
+	Start();
+}
+
+ThreadPool::ThreadPool(const NumaTopology& aTopology, size_t aThreadCount, bool aPinThreads)
+	: myNextWorker(0)
+	, mySignal(0)
+	, myIsStopping(false)
+{
+	const std::vector<NumaDomain>& domains = aTopology.GetDomains();
+	const size_t cpuCount = std::max<size_t>(aTopology.GetCpuCount(), 1);
+
+	if (aThreadCount == 0)
+		aThreadCount = 1;
+
+	myWorkers.reserve(aThreadCount);
+
+	size_t cpusBefore = 0;
+
+	for (const NumaDomain& domain : domains)
+	{
+		// cumulative rounding so the shares always add up to aThreadCount
+		size_t begin = cpusBefore * aThreadCount / cpuCount;
+		cpusBefore += domain.myCpus.size();
+		size_t end = cpusBefore * aThreadCount / cpuCount;
+
+		if (begin == end)
+			continue;
+
+		std::vector<size_t>& domainWorkers = myDomainWorkers.emplace_back();
+		myDomainCpus.push_back(aPinThreads ? domain.myCpus : std::vector<uint32_t>{});
+
+		for (size_t i = begin; i < end; i++)
+		{
+			std::unique_ptr<Worker>& worker = myWorkers.emplace_back(std::make_unique<Worker>());
+
+			worker->myDomain = myDomainWorkers.size() - 1;
+			domainWorkers.push_back(myWorkers.size() - 1);
+		}
+	}
+
+	Start();
+}
+
+ThreadPool::~ThreadPool()
+{
+	myIsStopping = true;
+
+	mySignal.fetch_add(1);
+	mySignal.notify_all();
+
+	for (std::thread& thread : myThreads)
+		thread.join();
+}
+
+void ThreadPool::Submit(Task aTask)
+{
+	if (std::optional<size_t> worker = CurrentWorker())
+	{
+		Push(*worker, std::move(aTask));
+		return;
+	}
+
+	Push(myNextWorker.fetch_add(1, std::memory_order_relaxed) % myWorkers.size(), std::move(aTask));
+}
+
+void ThreadPool::Submit(Task aTask, size_t aAffinity)
+{
+	Push(aAffinity % myWorkers.size(), std::move(aTask));
+}
+
+void ThreadPool::SubmitToDomain(Task aTask, size_t aDomain, size_t aAffinity)
+{
+	const std::vector<size_t>& domainWorkers = myDomainWorkers[aDomain];
+
+	Push(domainWorkers[aAffinity % domainWorkers.size()], std::move(aTask));
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return myWorkers.size();
+}
+
+size_t ThreadPool::GetDomainCount() const
+{
+	return myDomainWorkers.size();
+}
+
+size_t ThreadPool::GetDomainOf(size_t aWorker) const
+{
+	return myWorkers[aWorker]->myDomain;
+}
+
+std::span<const uint32_t> ThreadPool::GetDomainCpus(size_t aDomain) const
+{
+	return myDomainCpus[aDomain];
+}
+
+std::optional<size_t> ThreadPool::CurrentWorker() const
+{
+	if (LocalPool != this)
+		return {};
+
+	return LocalWorker;
+}
+
+std::optional<size_t> ThreadPool::CurrentDomain() const
+{
+	if (LocalPool != this)
+		return {};
+
+	return myWorkers[LocalWorker]->myDomain;
+}
+
+void ThreadPool::Start()
+{
+	myThreads.reserve(myWorkers.size());
+	for (size_t i = 0; i < myWorkers.size(); i++)
+		myThreads.emplace_back(&ThreadPool::Run, this, i);
+}
+
+void ThreadPool::Push(size_t aWorker, Task&& aTask)
+{
+	{
+		Worker& worker = *myWorkers[aWorker];
+
+		std::lock_guard lock(worker.myMutex);
+		worker.myTasks.push_back(std::move(aTask));
+	}
+
+	// any worker can steal it, so one is enough
+	mySignal.fetch_add(1, std::memory_order_release);
+	mySignal.notify_one();
+}
+
+// owners take from the front so their own work runs in submission order
+bool ThreadPool::TryPop(size_t aWorker, Task& aOut)
+{
+	Worker& worker = *myWorkers[aWorker];
+
+	std::lock_guard lock(worker.myMutex);
+
+	if (worker.myTasks.empty())
+		return false;
+
+	aOut = std::move(worker.myTasks.front());
+	worker.myTasks.pop_front();
+
+	return true;
+}
+
+// thieves take from the back, furthest away from what the owner is about to run
+// workers in the same domain are tried first, their tasks touch memory that is local to the thief too
+bool ThreadPool::TrySteal(size_t aThief, Task& aOut)
+{
+	const size_t domain = myWorkers[aThief]->myDomain;
+
+	for (size_t pass = 0; pass < 2; pass++)
+	{
+		for (size_t i = 1; i < myWorkers.size(); i++)
+		{
+			Worker& victim = *myWorkers[(aThief + i) % myWorkers.size()];
+
+			if ((victim.myDomain == domain) != (pass == 0))
+				continue;
+
+			std::lock_guard lock(victim.myMutex);
+
+			if (victim.myTasks.empty())
+				continue;
+
+			aOut = std::move(victim.myTasks.back());
+			victim.myTasks.pop_back();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::Run(size_t aIndex)
+{
+	LocalPool = this;
+	LocalWorker = aIndex;
+
+	if (std::span<const uint32_t> cpus = GetDomainCpus(myWorkers[aIndex]->myDomain); !cpus.empty())
+		NumaTopology::PinCurrentThread(cpus);
+
+	Task task;
+
+	while (true)
+	{
+		// read before looking for work, a submit after this bumps the signal and the wait falls through
+		uint32_t signal = mySignal.load(std::memory_order_acquire);
+
+		if (TryPop(aIndex, task) || TrySteal(aIndex, task))
+		{
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		// queues are drained before stopping so nobody is left waiting on a task that never ran
+		if (myIsStopping)
+			break;
+
+		mySignal.wait(signal, std::memory_order_acquire);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "NumaTopology.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+/// Node wide pool of worker threads, every worker has its own deque and steals from the others when it runs dry
+/// Threads live as long as the pool, sessions come and go without respawning them
+/// Workers are grouped by NUMA domain and steal from their own domain before reaching across
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	ThreadPool(size_t aThreadCount);
+
+	/// Spreads the threads over the domains in proportion to their cpu counts, optionally pinning every worker to its domain's cpus
+	ThreadPool(const NumaTopology& aTopology, size_t aThreadCount, bool aPinThreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	/// Queued on the calling worker when called from inside the pool, round robin otherwise
+	void Submit(Task aTask);
+
+	/// Queued on worker aAffinity % GetThreadCount(), idle workers may still steal it
+	void Submit(Task aTask, size_t aAffinity);
+
+	/// Queued on one of aDomain's workers, picked by aAffinity
+	void SubmitToDomain(Task aTask, size_t aDomain, size_t aAffinity);
+
+	size_t GetThreadCount() const;
+	size_t GetDomainCount() const;
+	size_t GetDomainOf(size_t aWorker) const;
+
+	/// Cpus the domain's workers are pinned to, empty when they are not pinned
+	std::span<const uint32_t> GetDomainCpus(size_t aDomain) const;
+
+	/// Index of the calling thread if it is one of this pool's workers
+	std::optional<size_t> CurrentWorker() const;
+	std::optional<size_t> CurrentDomain() const;
+
+private:
+	struct alignas(64) Worker
+	{
+		std::mutex myMutex;
+		std::deque<Task> myTasks;
+
+		size_t myDomain = 0;
+	};
+
+	void Start();
+
+	void Push(size_t aWorker, Task&& aTask);
+	bool TryPop(size_t aWorker, Task& aOut);
+	bool TrySteal(size_t aThief, Task& aOut);
+
+	void Run(size_t aIndex);
+
+	std::vector<std::unique_ptr<Worker>> myWorkers;
+	std::vector<std::thread> myThreads;
+	std::vector<std::vector<size_t>> myDomainWorkers;
+	std::vector<std::vector<uint32_t>> myDomainCpus;
+
+	std::atomic<size_t> myNextWorker;
+	std::atomic<uint32_t> mySignal; // bumped on every submit, idle workers wait on it
+	std::atomic<bool> myIsStopping;
+};
@@ -1,17 +1,26 @@
 #pragma once
 
-#include "tools/Iterators.h"
-
 #include "IRenderer.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <span>
 #include <thread>
+#include <vector>
 
+/// Runs a renderer on its own thread, jobs are handed over through single producer single consumer rings
+/// Texels and tiles have a ring each, so a large tile never holds back the single texels queued behind it
+/// QueueSize is per ring and has to be a power of two
 template<class TexelType, size_t QueueSize>
 class ThreadedRenderer : public IAsyncRenderer<TexelType>
 {
 public:
 	using Result = IAsyncRenderer<TexelType>::Result;
+	using TileResult = IAsyncRenderer<TexelType>::TileResult;
 
 	ThreadedRenderer(IRenderer<TexelType>& aBaseRenderer);
 	~ThreadedRenderer();
@@ -28,51 +37,83 @@ public:
 	void Render(fisk::tools::V2ui aUV) override;
 	bool GetResult(Result& aOut) override;
 
+	size_t RenderBatch(std::span<const fisk::tools::V2ui> aUVs) override;
+	size_t GetResults(std::span<Result> aOut) override;
+
+	bool SupportsTiles() override;
+
+	bool CanRenderTile(TexelRect aRect) override;
+	void RenderTile(TexelRect aRect) override;
+	bool GetTileResult(TileResult& aOut) override;
+
 	size_t GetPending() override;
 
+	void SetResultSignal(ResultSignal* aSignal) override;
+
 private:
+	static_assert(QueueSize > 0 && (QueueSize & (QueueSize - 1)) == 0, "QueueSize has to be a power of two");
+
+	static constexpr size_t CacheLine = 64;
+	static constexpr size_t Mask = QueueSize - 1;
 
 	void Run();
-	
-	enum class RenderSlotState : uint8_t
+
+	/// Wakes the worker, call once after publishing one or more jobs
+	void SignalJobs();
+
+	// padded to a cache line so the worker finishing one job does not invalidate the slot the submitter is filling
+	struct alignas(CacheLine) TexelJob
 	{
-		Empty,
-		Working,
-		Done
+		fisk::tools::V2ui			myUV;
+		TexelType					myResult;
 	};
 
-	struct RenderJob
+	struct alignas(CacheLine) TileJob
 	{
-		fisk::tools::V2ui	myUV;
-		TexelType			myResult;
-		RenderSlotState		myState;
+		TexelRect					myRect;
+		std::vector<TexelType>		myTexels;
 	};
 
-	IRenderer<TexelType>&					myBaseRenderer;		// Internal thread
-	std::thread								myThread;			// External thread
-	size_t									myPending;			// External thread
+	// Indices only ever grow, a slot is Slot(index). Jobs in [read, done) are finished, [done, write) are queued or being worked on
+	template<class Job>
+	struct Ring
+	{
+		Job& Slot(uint64_t aIndex) { return myJobs[aIndex & Mask]; }
+
+		Job										myJobs[QueueSize];	// Shared, owned by whoever the indices say
 
-	RenderJob								myJobs[QueueSize];	// Shared
+		alignas(CacheLine) std::atomic<uint64_t>	myWriteIndex = 0;	// Written by the external thread
+		alignas(CacheLine) std::atomic<uint64_t>	myDoneIndex = 0;	// Written by the internal thread
+		alignas(CacheLine) uint64_t					myReadIndex = 0;	// External thread
+	};
+
+	/// Renders and publishes one job, returns the next index to render
+	uint64_t RunTexel(uint64_t aIndex);
+	uint64_t RunTile(uint64_t aIndex);
 
-	fisk::tools::LoopingPointer<RenderJob*>	myWriteHead;		// External thread
-	fisk::tools::LoopingPointer<RenderJob*>	myReadHead;			// External thread
+	void NotifyResult();
 
-	fisk::tools::LoopingPointer<RenderJob*>	myRenderHead;		// Internal thread
+	static constexpr size_t MinSpin = 16;
+	static constexpr size_t MaxSpin = 1024;
+	static constexpr size_t MaxClaim = 16;		// texels the worker takes per look at the write index
 
-	std::atomic<bool>						myStopRequested;	// Shared
+	IRenderer<TexelType>&					myBaseRenderer;		// Internal thread
+	std::thread								myThread;			// External thread
 
+	Ring<TexelJob>							myTexels;
+	Ring<TileJob>							myTiles;
 
+	alignas(CacheLine) std::atomic<bool>		myStopRequested;	// Shared
+	std::atomic<uint32_t>						myJobSignal;		// Shared, bumped whenever there is something new for the worker
+	std::atomic<ResultSignal*>					myResultSignal;		// Shared
 };
 
 template<class TexelType, size_t QueueSize>
 inline ThreadedRenderer<TexelType, QueueSize>::ThreadedRenderer(IRenderer<TexelType>& aBaseRenderer)
 	: myBaseRenderer(aBaseRenderer)
-	, myPending(0)
 	, myStopRequested(false)
-	, myJobs{}
-	, myReadHead(myJobs, QueueSize)
-	, myWriteHead(myJobs, QueueSize)
-	, myRenderHead(myJobs, QueueSize)
+	, myJobSignal(0)
+	, myResultSignal(nullptr)
 {
 	myThread = std::move(std::thread(std::bind(&ThreadedRenderer::Run, this)));
 }
@@ -89,6 +130,7 @@ inline void ThreadedRenderer<TexelType, QueueSize>::StopThread()
 	if (myThread.joinable())
 	{
 		myStopRequested = true;
+		SignalJobs();
 		myThread.join();
 	}
 }
@@ -96,38 +138,99 @@ inline void ThreadedRenderer<TexelType, QueueSize>::StopThread()
 template<class TexelType, size_t QueueSize>
 inline bool ThreadedRenderer<TexelType, QueueSize>::CanRender(fisk::tools::V2ui aUV)
 {
-	return myWriteHead->myState == RenderSlotState::Empty;
+	return myTexels.myWriteIndex.load(std::memory_order_relaxed) - myTexels.myReadIndex < QueueSize;
 }
 
 template<class TexelType, size_t QueueSize>
 inline void ThreadedRenderer<TexelType, QueueSize>::Render(fisk::tools::V2ui aUV)
 {
-	myWriteHead->myUV = aUV;
-	myWriteHead->myResult = {};
-	myWriteHead->myState = RenderSlotState::Working;
+	RenderBatch(std::span<const fisk::tools::V2ui>(&aUV, 1));
+}
+
+template<class TexelType, size_t QueueSize>
+inline bool ThreadedRenderer<TexelType, QueueSize>::GetResult(Result& aOut)
+{
+	return GetResults(std::span<Result>(&aOut, 1)) == 1;
+}
 
-	myWriteHead++;
+template<class TexelType, size_t QueueSize>
+inline size_t ThreadedRenderer<TexelType, QueueSize>::RenderBatch(std::span<const fisk::tools::V2ui> aUVs)
+{
+	uint64_t write = myTexels.myWriteIndex.load(std::memory_order_relaxed);
+	size_t count = std::min<size_t>(aUVs.size(), QueueSize - (write - myTexels.myReadIndex));
 
-	myPending++;
+	if (count == 0)
+		return 0;
+
+	for (size_t i = 0; i < count; i++)
+		myTexels.Slot(write + i).myUV = aUVs[i];
+
+	// one release publishes the whole run
+	myTexels.myWriteIndex.store(write + count, std::memory_order_release);
+
+	SignalJobs();
+
+	return count;
 }
 
 template<class TexelType, size_t QueueSize>
-inline bool ThreadedRenderer<TexelType, QueueSize>::GetResult(Result& aOut)
+inline size_t ThreadedRenderer<TexelType, QueueSize>::GetResults(std::span<Result> aOut)
 {
-	if (myReadHead->myState != RenderSlotState::Done)
-		return false;
+	uint64_t done = myTexels.myDoneIndex.load(std::memory_order_acquire);
+	size_t count = std::min<size_t>(aOut.size(), done - myTexels.myReadIndex);
 
-	aOut =
+	for (size_t i = 0; i < count; i++)
 	{
-		myReadHead->myUV,
-		myReadHead->myResult
-	};
+		TexelJob& job = myTexels.Slot(myTexels.myReadIndex + i);
 
-	myReadHead->myState = RenderSlotState::Empty;
+		aOut[i] =
+		{
+			job.myUV,
+			job.myResult
+		};
+	}
 
-	myReadHead++;
+	myTexels.myReadIndex += count;
 
-	myPending--;
+	return count;
+}
+
+template<class TexelType, size_t QueueSize>
+inline bool ThreadedRenderer<TexelType, QueueSize>::SupportsTiles()
+{
+	return true;
+}
+
+template<class TexelType, size_t QueueSize>
+inline bool ThreadedRenderer<TexelType, QueueSize>::CanRenderTile(TexelRect aRect)
+{
+	return myTiles.myWriteIndex.load(std::memory_order_relaxed) - myTiles.myReadIndex < QueueSize;
+}
+
+template<class TexelType, size_t QueueSize>
+inline void ThreadedRenderer<TexelType, QueueSize>::RenderTile(TexelRect aRect)
+{
+	uint64_t write = myTiles.myWriteIndex.load(std::memory_order_relaxed);
+
+	myTiles.Slot(write).myRect = aRect;
+
+	myTiles.myWriteIndex.store(write + 1, std::memory_order_release);
+
+	SignalJobs();
+}
+
+template<class TexelType, size_t QueueSize>
+inline bool ThreadedRenderer<TexelType, QueueSize>::GetTileResult(TileResult& aOut)
+{
+	if (myTiles.myReadIndex == myTiles.myDoneIndex.load(std::memory_order_acquire))
+		return false;
+
+	TileJob& job = myTiles.Slot(myTiles.myReadIndex);
+
+	aOut.myRect = job.myRect;
+	std::swap(aOut.myTexels, job.myTexels);
+
+	myTiles.myReadIndex++;
 
 	return true;
 }
@@ -135,22 +238,114 @@ inline bool ThreadedRenderer<TexelType, QueueSize>::GetResult(Result& aOut)
 template<class TexelType, size_t QueueSize>
 inline size_t ThreadedRenderer<TexelType, QueueSize>::GetPending()
 {
-	return myPending;
+	return (myTexels.myWriteIndex.load(std::memory_order_relaxed) - myTexels.myReadIndex)
+		+ (myTiles.myWriteIndex.load(std::memory_order_relaxed) - myTiles.myReadIndex);
+}
+
+template<class TexelType, size_t QueueSize>
+inline void ThreadedRenderer<TexelType, QueueSize>::SetResultSignal(ResultSignal* aSignal)
+{
+	myResultSignal = aSignal;
+}
+
+template<class TexelType, size_t QueueSize>
+inline void ThreadedRenderer<TexelType, QueueSize>::SignalJobs()
+{
+	myJobSignal.fetch_add(1, std::memory_order_release);
+	myJobSignal.notify_one();
+}
+
+template<class TexelType, size_t QueueSize>
+inline void ThreadedRenderer<TexelType, QueueSize>::NotifyResult()
+{
+	if (ResultSignal* resultSignal = myResultSignal.load())
+		resultSignal->Notify();
+}
+
+template<class TexelType, size_t QueueSize>
+inline uint64_t ThreadedRenderer<TexelType, QueueSize>::RunTexel(uint64_t aIndex)
+{
+	TexelJob& job = myTexels.Slot(aIndex);
+	job.myResult = myBaseRenderer.Render(job.myUV);
+
+	// results are published one at a time so the first texel of a run is not held back by the rest
+	myTexels.myDoneIndex.store(aIndex + 1, std::memory_order_release);
+	NotifyResult();
+
+	return aIndex + 1;
+}
+
+template<class TexelType, size_t QueueSize>
+inline uint64_t ThreadedRenderer<TexelType, QueueSize>::RunTile(uint64_t aIndex)
+{
+	TileJob& job = myTiles.Slot(aIndex);
+
+	job.myTexels.resize(job.myRect.Area());
+	myBaseRenderer.RenderTile(job.myRect, job.myTexels);
+
+	myTiles.myDoneIndex.store(aIndex + 1, std::memory_order_release);
+	NotifyResult();
+
+	return aIndex + 1;
 }
 
 template<class TexelType, size_t QueueSize>
 inline void ThreadedRenderer<TexelType, QueueSize>::Run()
 {
-	while (!myStopRequested)
+	size_t spin = MinSpin;
+
+	// only the worker moves these, they are published through the done indices
+	uint64_t texel = 0;
+	uint64_t tile = 0;
+
+	while (true)
 	{
-		if (myRenderHead->myState != RenderSlotState::Working)
+		// read before checking the rings, anything published after this bumps the signal and the wait falls through
+		uint32_t signal = myJobSignal.load(std::memory_order_acquire);
+
+		if (myStopRequested)
+			break;
+
+		uint64_t texelWrite = myTexels.myWriteIndex.load(std::memory_order_acquire);
+		uint64_t tileWrite = myTiles.myWriteIndex.load(std::memory_order_acquire);
+
+		auto idle = [&]() { return texel == texelWrite && tile == tileWrite; };
+
+		if (idle())
 		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			// jobs tend to come in bursts, spin a little before going to sleep and spin longer if that paid off
+			for (size_t i = 0; i < spin && idle(); i++)
+			{
+				std::this_thread::yield();
+				texelWrite = myTexels.myWriteIndex.load(std::memory_order_acquire);
+				tileWrite = myTiles.myWriteIndex.load(std::memory_order_acquire);
+			}
+
+			if (!idle())
+			{
+				spin = std::min(spin * 2, MaxSpin);
+			}
+			else
+			{
+				spin = std::max(spin / 2, MinSpin);
+				myJobSignal.wait(signal, std::memory_order_acquire);
+				continue;
+			}
+		}
+
+		// texels go first, they are quick and whoever is waiting on them should not wait for a whole tile
+		if (texel != texelWrite)
+		{
+			// claim a run, the write index is not looked at again until it is done
+			uint64_t end = std::min<uint64_t>(texelWrite, texel + MaxClaim);
+
+			while (texel < end)
+				texel = RunTexel(texel);
+
 			continue;
 		}
 
-		myRenderHead->myResult = myBaseRenderer.Render(myRenderHead->myUV);
-		myRenderHead->myState = RenderSlotState::Done;
-		myRenderHead++;
+		// a single tile, then back to look for texels that came in meanwhile
+		tile = RunTile(tile);
 	}
 }
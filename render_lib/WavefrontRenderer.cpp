@@ -0,0 +1,246 @@
+#include "WavefrontRenderer.h"
+
+#include <chrono>
+
+void WavefrontRenderer::PathPool::Reset(size_t aCount)
+{
+	myRays.resize(aCount);
+	myHits.assign(aCount, std::nullopt);
+	myThroughput.assign(aCount, { 1, 1, 1 });
+	myDiffuseNormal.assign(aCount, { 0, 0, 0 });
+	myIsDiffuse.assign(aCount, 0);
+	myIsAlive.assign(aCount, 1);
+	mySample.resize(aCount);
+	myBounces.assign(aCount, 0);
+
+	for (size_t i = 0; i < aCount; i++)
+		mySample[i] = static_cast<uint32_t>(i);
+}
+
+WavefrontRenderer::WavefrontRenderer(const Scene& aScene, IIntersector& aIntersector, size_t aSamplesPerTexel, size_t aMinBounces, bool aSortSecondaryRays, unsigned int aRendererId)
+	: myRayCaster(aScene.GetCamera())
+	, myIntersector(aIntersector)
+	, mySky(aScene.GetSky())
+	, mySamplesPerTexel(aSamplesPerTexel)
+	, myMinBounces(aMinBounces)
+	, mySortSecondaryRays(aSortSecondaryRays)
+	, myRendererId(aRendererId)
+{
+	const std::vector<SceneObject<PolyObject>>& objects = aScene.GetObjects();
+
+	if (objects.empty())
+		return;
+
+	fisk::tools::AxisAlignedBox<float, 3> bounds = objects[0].myShape.myBoundingBox;
+
+	for (const SceneObject<PolyObject>& object : objects)
+	{
+		bounds.ExpandToInclude(object.myShape.myBoundingBox.myMin);
+		bounds.ExpandToInclude(object.myShape.myBoundingBox.myMax);
+	}
+
+	mySorter = RaySorter(bounds);
+}
+
+WavefrontRenderer::Result WavefrontRenderer::Render(fisk::tools::V2ui aUV) const
+{
+	Result out;
+
+	RenderTile(TexelRect{ aUV, { 1, 1 } }, std::span<Result>(&out, 1));
+
+	return out;
+}
+
+void WavefrontRenderer::RenderTile(TexelRect aRect, std::span<Result> aOut) const
+{
+	using clock = std::chrono::high_resolution_clock;
+	clock::time_point start = clock::now();
+
+	// kept per worker thread so the buffers only grow once
+	thread_local PathPool pool;
+	thread_local std::vector<path_tracing::Sample> samples;
+
+	samples.assign(aOut.size() * mySamplesPerTexel, {});
+
+	path_tracing::Statistics statistics;
+
+	Generate(pool, aRect);
+	statistics.myPaths += pool.myRays.size();
+
+	for (size_t wave = 0; !pool.myRays.empty(); wave++)
+	{
+		Extend(pool, wave, statistics);
+		Shade(pool, samples, statistics);
+		Connect(pool, samples);
+		Compact(pool);
+	}
+
+	myStatistics.Add(statistics);
+
+	// the texels are traced together, so they all get the same share of the time
+	CompactNanoSecond time = (clock::now() - start) / samples.size();
+
+	path_tracing::ResolveTile(samples, mySamplesPerTexel, aOut);
+
+	for (size_t i = 0; i < aOut.size(); i++)
+	{
+		std::get<TimeChannel>(aOut[i]) = time;
+		std::get<RendererChannel>(aOut[i]) = myRendererId;
+	}
+}
+
+const path_tracing::StatisticsCounter& WavefrontRenderer::GetStatistics() const
+{
+	return myStatistics;
+}
+
+void WavefrontRenderer::Generate(PathPool& aPool, TexelRect aRect) const
+{
+	// samples are texel major, which is the order the camera generates them in
+	aPool.Reset(aRect.Area() * mySamplesPerTexel);
+
+	myRayCaster.RenderBatch(aRect, mySamplesPerTexel, aPool.myRays);
+}
+
+void WavefrontRenderer::Extend(PathPool& aPool, size_t aWave, path_tracing::Statistics& aInOutStatistics) const
+{
+	using clock = std::chrono::high_resolution_clock;
+	clock::time_point start = clock::now();
+
+	aInOutStatistics.mySegments += aPool.myRays.size();
+
+	// camera rays are coherent already, bounced ones are not
+	if (!mySortSecondaryRays || aWave == 0)
+	{
+		myIntersector.IntersectBatch(aPool.myRays, aPool.myHits);
+	}
+	else
+	{
+		mySorter.Sort(aPool.myRays, aPool.mySortOrder);
+
+		aPool.mySortedRays.resize(aPool.myRays.size());
+		aPool.mySortedHits.resize(aPool.myRays.size());
+
+		for (size_t i = 0; i < aPool.mySortOrder.size(); i++)
+			aPool.mySortedRays[i] = aPool.myRays[aPool.mySortOrder[i]];
+
+		myIntersector.IntersectBatch(aPool.mySortedRays, aPool.mySortedHits);
+
+		for (size_t i = 0; i < aPool.mySortOrder.size(); i++)
+			aPool.myHits[aPool.mySortOrder[i]] = aPool.mySortedHits[i];
+	}
+
+	aInOutStatistics.myIntersectionTime += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+}
+
+void WavefrontRenderer::Shade(PathPool& aPool, std::vector<path_tracing::Sample>& aSamples, path_tracing::Statistics& aInOutStatistics) const
+{
+	aPool.myShadowRays.clear();
+	aPool.myShadowRadiance.clear();
+	aPool.myShadowSample.clear();
+
+	for (size_t i = 0; i < aPool.myRays.size(); i++)
+	{
+		path_tracing::Sample& sample = aSamples[aPool.mySample[i]];
+		fisk::tools::V3f& throughput = aPool.myThroughput[i];
+		std::optional<Hit>& hit = aPool.myHits[i];
+
+		if (!hit)
+		{
+			std::optional<fisk::tools::V3f> diffuseNormal;
+
+			if (aPool.myIsDiffuse[i])
+				diffuseNormal = aPool.myDiffuseNormal[i];
+
+			sample.myColor += throughput * path_tracing::EscapeRadiance(mySky, aPool.myRays[i].myDirection, diffuseNormal);
+			aPool.myIsAlive[i] = 0;
+			continue;
+		}
+
+		Material::Interaction interaction = hit->myMaterial->InteractWith(aPool.myRays[i], *hit, throughput);
+
+		if (sample.myObjectId == 0)
+		{
+			sample.myObjectId = hit->myObjectId;
+			sample.mySubObjectId = hit->mySubObjectId;
+		}
+
+		aPool.myIsDiffuse[i] = 0;
+
+		if (interaction == Material::Interaction::Diffuse)
+		{
+			std::optional<path_tracing::SunSample> sun = path_tracing::SampleSun(mySky, *hit);
+
+			if (sun)
+			{
+				aPool.myShadowRays.push_back(sun->myShadowRay);
+				aPool.myShadowRadiance.push_back(throughput * sun->myRadiance);
+				aPool.myShadowSample.push_back(aPool.mySample[i]);
+			}
+
+			aPool.myIsDiffuse[i] = 1;
+			aPool.myDiffuseNormal[i] = hit->myNormal;
+		}
+
+		uint32_t bounces = ++aPool.myBounces[i];
+
+		if (bounces >= myMinBounces && !path_tracing::SurvivesRoulette(throughput))
+		{
+			aInOutStatistics.myTerminated++;
+			aPool.myIsAlive[i] = 0;
+			continue;
+		}
+
+		if (bounces >= path_tracing::MaxBounces)
+			aPool.myIsAlive[i] = 0;
+	}
+}
+
+void WavefrontRenderer::Connect(PathPool& aPool, std::vector<path_tracing::Sample>& aSamples) const
+{
+	if (aPool.myShadowRays.empty())
+		return;
+
+	aPool.myShadowOccluded.resize(aPool.myShadowRays.size());
+
+	myIntersector.OccludedBatch(aPool.myShadowRays, aPool.myShadowOccluded);
+
+	for (size_t i = 0; i < aPool.myShadowRays.size(); i++)
+	{
+		if (!aPool.myShadowOccluded[i])
+			aSamples[aPool.myShadowSample[i]].myColor += aPool.myShadowRadiance[i];
+	}
+}
+
+void WavefrontRenderer::Compact(PathPool& aPool) const
+{
+	size_t alive = 0;
+
+	for (size_t i = 0; i < aPool.myRays.size(); i++)
+	{
+		if (!aPool.myIsAlive[i])
+			continue;
+
+		if (alive != i)
+		{
+			aPool.myRays[alive] = aPool.myRays[i];
+			aPool.myThroughput[alive] = aPool.myThroughput[i];
+			aPool.myDiffuseNormal[alive] = aPool.myDiffuseNormal[i];
+			aPool.myIsDiffuse[alive] = aPool.myIsDiffuse[i];
+			aPool.myIsAlive[alive] = 1;
+			aPool.mySample[alive] = aPool.mySample[i];
+			aPool.myBounces[alive] = aPool.myBounces[i];
+		}
+
+		alive++;
+	}
+
+	aPool.myRays.resize(alive);
+	aPool.myHits.resize(alive);
+	aPool.myThroughput.resize(alive);
+	aPool.myDiffuseNormal.resize(alive);
+	aPool.myIsDiffuse.resize(alive);
+	aPool.myIsAlive.resize(alive);
+	aPool.mySample.resize(alive);
+	aPool.myBounces.resize(alive);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "tools/Shapes.h"
+
+#include "Camera.h"
+#include "Scene.h"
+#include "IRenderer.h"
+#include "RendererTypes.h"
+#include "IIntersector.h"
+#include "PathTracing.h"
+#include "RaySorter.h"
+#include "Sky.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+/// Traces all samples of a texel, or a tile of texels, breadth first, every stage runs over the whole pool of paths before the next one starts
+class WavefrontRenderer : public IRenderer<TextureType::PackedValues>
+{
+public:
+	using RayCaster = Camera;
+
+	WavefrontRenderer(const Scene& aScene, IIntersector& aIntersector, size_t aSamplesPerTexel, size_t aMinBounces, bool aSortSecondaryRays, unsigned int aRendererId);
+
+	Result Render(fisk::tools::V2ui aUV) const override;
+
+	/// Every sample of every texel in the tile shares one pool, so the waves stay wide
+	void RenderTile(TexelRect aRect, std::span<Result> aOut) const override;
+
+	const path_tracing::StatisticsCounter& GetStatistics() const;
+
+private:
+
+	/// Structure of arrays over every path in flight, index i in each buffer belongs to the same path
+	struct PathPool
+	{
+		/// Sets up aCount fresh paths, the rays are left for the caller to fill in
+		void Reset(size_t aCount);
+
+		std::vector<fisk::tools::Ray<float, 3>> myRays;
+		std::vector<std::optional<Hit>> myHits;
+		std::vector<fisk::tools::V3f> myThroughput;
+		std::vector<fisk::tools::V3f> myDiffuseNormal;
+		std::vector<uint8_t> myIsDiffuse;
+		std::vector<uint8_t> myIsAlive;
+		std::vector<uint32_t> mySample;
+		std::vector<uint32_t> myBounces;
+
+		std::vector<fisk::tools::Ray<float, 3>> myShadowRays;
+		std::vector<fisk::tools::V3f> myShadowRadiance;
+		std::vector<uint32_t> myShadowSample;
+		std::vector<uint8_t> myShadowOccluded;
+
+		std::vector<uint32_t> mySortOrder;
+		std::vector<fisk::tools::Ray<float, 3>> mySortedRays;
+		std::vector<std::optional<Hit>> mySortedHits;
+	};
+
+	void Generate(PathPool& aPool, TexelRect aRect) const;
+	void Extend(PathPool& aPool, size_t aWave, path_tracing::Statistics& aInOutStatistics) const;
+	void Shade(PathPool& aPool, std::vector<path_tracing::Sample>& aSamples, path_tracing::Statistics& aInOutStatistics) const;
+	void Connect(PathPool& aPool, std::vector<path_tracing::Sample>& aSamples) const;
+	void Compact(PathPool& aPool) const;
+
+	const RayCaster& myRayCaster;
+	IIntersector& myIntersector;
+	const Sky& mySky;
+	size_t mySamplesPerTexel;
+	size_t myMinBounces;
+	bool mySortSecondaryRays;
+	unsigned int myRendererId;
+
+	RaySorter mySorter;
+
+	mutable path_tracing::StatisticsCounter myStatistics;
+};
@@ -8,6 +8,35 @@
 
 namespace cluster_intersector
 {
+	void RayStream::Reset(std::span<const fisk::tools::Ray<float, 3>> aRays, bool aAnyHit)
+	{
+		myRays = aRays;
+		myAnyHit = aAnyHit;
+
+		myPreDivided.resize(aRays.size());
+		myAll.resize(aRays.size());
+
+		for (uint32_t i = 0; i < aRays.size(); i++)
+		{
+			const fisk::tools::V3f& direction = aRays[i].myDirection;
+
+			myPreDivided[i] = { 1.f / direction[0], 1.f / direction[1], 1.f / direction[2] };
+			myAll[i] = i;
+		}
+
+		myDepths.assign(aRays.size(), std::numeric_limits<float>::max());
+		myHits.assign(aRays.size(), Hit{});
+		myOccluded.assign(aRays.size(), 0);
+	}
+
+	std::vector<uint32_t>& RayStream::ActiveAt(size_t aDepth)
+	{
+		while (myActive.size() <= aDepth)
+			myActive.emplace_back();
+
+		return myActive[aDepth];
+	}
+
 
 	Leaf::Leaf(const std::vector<fisk::tools::Tri<float>>& aFragments, const Material* aMaterial, unsigned int aId, std::string aName)
 	{
@@ -57,6 +86,75 @@ namespace cluster_intersector
 		}
 	}
 
+	bool Leaf::Occludes(fisk::tools::Ray<float, 3> aRay, const fisk::tools::V3f& aPreDividedDirection)
+	{
+		if (!fisk::tools::IntersectRayBoxPredivided<float, 3>(aRay.myOrigin, aPreDividedDirection, myFragment.myBoundingBox))
+			return false;
+
+		for (const fisk::tools::Tri<float>& tri : myFragment.myTris)
+		{
+			if (fisk::tools::Intersect(aRay, tri))
+				return true;
+		}
+
+		return false;
+	}
+
+	void Leaf::Intersect(RayStream& aStream, const std::vector<uint32_t>& aActive, size_t aDepth)
+	{
+		std::vector<uint32_t>& active = aStream.ActiveAt(aDepth);
+		active.clear();
+
+		for (uint32_t index : aActive)
+		{
+			if (aStream.myOccluded[index])
+				continue;
+
+			std::optional<float> boundingHit = fisk::tools::IntersectRayBoxPredivided<float, 3>(aStream.myRays[index].myOrigin, aStream.myPreDivided[index], myFragment.myBoundingBox);
+
+			if (boundingHit && *boundingHit < aStream.myDepths[index])
+				active.push_back(index);
+		}
+
+		// tri major so each tri is loaded once for the whole stream
+		for (unsigned int i = 0; i < myFragment.myTris.size() && !active.empty(); i++)
+		{
+			const fisk::tools::Tri<float>& tri = myFragment.myTris[i];
+
+			for (uint32_t index : active)
+			{
+				if (aStream.myOccluded[index])
+					continue;
+
+				const fisk::tools::Ray<float, 3>& ray = aStream.myRays[index];
+
+				std::optional<float> hit = fisk::tools::Intersect(ray, tri);
+
+				if (!hit)
+					continue;
+
+				if (*hit > aStream.myDepths[index])
+					continue;
+
+				if (aStream.myAnyHit)
+				{
+					aStream.myOccluded[index] = 1;
+					continue;
+				}
+
+				aStream.myDepths[index] = *hit;
+
+				Hit& out = aStream.myHits[index];
+
+				out.myPosition = ray.myOrigin + ray.myDirection * *hit;
+				out.myNormal = tri.Normal();
+				out.myObjectId = myId;
+				out.mySubObjectId = i + 1;
+				out.myMaterial = myMaterial;
+			}
+		}
+	}
+
 	fisk::tools::AxisAlignedBox<float, 3> Leaf::GetBoundingBox()
 	{
 		return myFragment.myBoundingBox;
@@ -108,6 +206,52 @@ namespace cluster_intersector
 			node->Intersect(aRay, aPreDividedDirection, aInOutDepth, aInOutHit);
 	}
 
+	bool Node::Occludes(fisk::tools::Ray<float, 3> aRay, const fisk::tools::V3f& aPreDividedDirection)
+	{
+		if (!fisk::tools::IntersectRayBoxPredivided<float, 3>(aRay.myOrigin, aPreDividedDirection, myBoundingBox))
+			return false;
+
+		for (std::unique_ptr<Leaf>& leaf : myLeafs)
+		{
+			if (leaf->Occludes(aRay, aPreDividedDirection))
+				return true;
+		}
+
+		for (std::unique_ptr<Node>& node : myChildren)
+		{
+			if (node->Occludes(aRay, aPreDividedDirection))
+				return true;
+		}
+
+		return false;
+	}
+
+	void Node::Intersect(RayStream& aStream, const std::vector<uint32_t>& aActive, size_t aDepth)
+	{
+		std::vector<uint32_t>& active = aStream.ActiveAt(aDepth);
+		active.clear();
+
+		for (uint32_t index : aActive)
+		{
+			if (aStream.myOccluded[index])
+				continue;
+
+			std::optional<float> boundingHit = fisk::tools::IntersectRayBoxPredivided<float, 3>(aStream.myRays[index].myOrigin, aStream.myPreDivided[index], myBoundingBox);
+
+			if (boundingHit && *boundingHit < aStream.myDepths[index])
+				active.push_back(index);
+		}
+
+		if (active.empty())
+			return;
+
+		for (std::unique_ptr<Leaf>& leaf : myLeafs)
+			leaf->Intersect(aStream, active, aDepth + 1);
+
+		for (std::unique_ptr<Node>& node : myChildren)
+			node->Intersect(aStream, active, aDepth + 1);
+	}
+
 	void Node::Add(std::unique_ptr<Leaf>&& aLeaf)
 	{
 		if (myChildren.empty() && myLeafs.empty())
@@ -216,6 +360,44 @@ std::optional<Hit> ClusteredIntersector::Intersect(fisk::tools::Ray<float, 3> aR
 
 }
 
+bool ClusteredIntersector::Occluded(fisk::tools::Ray<float, 3> aRay)
+{
+	fisk::tools::V3f preDivedRayDir
+	{
+		1.f / aRay.myDirection[0],
+		1.f / aRay.myDirection[1],
+		1.f / aRay.myDirection[2]
+	};
+
+	return myRootNode->Occludes(aRay, preDivedRayDir);
+}
+
+void ClusteredIntersector::IntersectBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<std::optional<Hit>> aOutHits)
+{
+	thread_local cluster_intersector::RayStream stream;
+
+	stream.Reset(aRays, false);
+	myRootNode->Intersect(stream, stream.myAll, 0);
+
+	for (size_t i = 0; i < aRays.size(); i++)
+	{
+		if (stream.myDepths[i] == std::numeric_limits<float>::max())
+			aOutHits[i].reset();
+		else
+			aOutHits[i] = stream.myHits[i];
+	}
+}
+
+void ClusteredIntersector::OccludedBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<uint8_t> aOutOccluded)
+{
+	thread_local cluster_intersector::RayStream stream;
+
+	stream.Reset(aRays, true);
+	myRootNode->Intersect(stream, stream.myAll, 0);
+
+	std::copy(stream.myOccluded.begin(), stream.myOccluded.end(), aOutOccluded.begin());
+}
+
 void ClusteredIntersector::Imgui(fisk::tools::V2ui aWindowSize, Camera& aCamera, size_t aRenderScale)
 {
 	float floatRenderScale = static_cast<float>(aRenderScale);
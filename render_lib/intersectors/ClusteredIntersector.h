@@ -7,6 +7,9 @@
 #include "Material.h"
 #include "Camera.h"
 
+#include <cstdint>
+#include <deque>
+#include <span>
 #include <string>
 #include <vector>
 #include <optional>
@@ -22,12 +25,31 @@ namespace cluster_intersector
 		std::vector<fisk::tools::Tri<float>> myTris;
 	};
 
+	/// Traversal state for a batch of rays, every node tests its bounds against all rays still active below it
+	struct RayStream
+	{
+		void Reset(std::span<const fisk::tools::Ray<float, 3>> aRays, bool aAnyHit);
+
+		std::vector<uint32_t>& ActiveAt(size_t aDepth);
+
+		std::span<const fisk::tools::Ray<float, 3>> myRays;
+		std::vector<fisk::tools::V3f> myPreDivided;
+		std::vector<float> myDepths;
+		std::vector<Hit> myHits;
+		std::vector<uint8_t> myOccluded;
+		std::vector<uint32_t> myAll;
+		std::deque<std::vector<uint32_t>> myActive; // one list per traversal depth, deque to keep references stable
+		bool myAnyHit = false;
+	};
+
 	class Leaf
 	{
 	public:
 		Leaf(const std::vector<fisk::tools::Tri<float>>& aFragments, const Material* aMaterial, unsigned int aId, std::string aName);
 
 		void Intersect(fisk::tools::Ray<float, 3> aRay,const fisk::tools::V3f& aPreDividedDirection, float& aInOutDepth, Hit& aInOutHit);
+		bool Occludes(fisk::tools::Ray<float, 3> aRay, const fisk::tools::V3f& aPreDividedDirection);
+		void Intersect(RayStream& aStream, const std::vector<uint32_t>& aActive, size_t aDepth);
 
 		fisk::tools::AxisAlignedBox<float, 3> GetBoundingBox();
 
@@ -49,6 +71,8 @@ namespace cluster_intersector
 		Node(std::string aName);
 
 		void Intersect(fisk::tools::Ray<float, 3> aRay,const fisk::tools::V3f& aPreDividedDirection, float& aInOutDepth, Hit& aInOutHit);
+		bool Occludes(fisk::tools::Ray<float, 3> aRay, const fisk::tools::V3f& aPreDividedDirection);
+		void Intersect(RayStream& aStream, const std::vector<uint32_t>& aActive, size_t aDepth);
 
 		void Add(std::unique_ptr<Leaf>&& aLeaf);
 		void Add(std::unique_ptr<Node>&& aNode);
@@ -69,12 +93,16 @@ namespace cluster_intersector
 	};
 }
 
-class ClusteredIntersector : public IIntersector
+class ClusteredIntersector final : public IIntersector
 {
 public:
 	ClusteredIntersector(const Scene& aScene, size_t aFragmentSize, size_t aClustersPerNode);
 
 	std::optional<Hit> Intersect(fisk::tools::Ray<float, 3> aRay) override;
+	bool Occluded(fisk::tools::Ray<float, 3> aRay) override;
+
+	void IntersectBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<std::optional<Hit>> aOutHits) override;
+	void OccludedBatch(std::span<const fisk::tools::Ray<float, 3>> aRays, std::span<uint8_t> aOutOccluded) override;
 
 	void Imgui(fisk::tools::V2ui aWindowSize, Camera& aCamera, size_t aRenderScale);
 
@@ -54,3 +54,27 @@ std::optional<Hit> DumbIntersector::Intersect(fisk::tools::Ray<float, 3> aRay)
 
     return out;
 }
+
+bool DumbIntersector::Occluded(fisk::tools::Ray<float, 3> aRay)
+{
+	fisk::tools::V3f preDivedRayDir
+	{
+		1.f / aRay.myDirection[0],
+		1.f / aRay.myDirection[1],
+		1.f / aRay.myDirection[2]
+	};
+
+	for (const SceneObject<PolyObject>& poly : myScene.GetObjects())
+	{
+		if (!fisk::tools::IntersectRayBoxPredivided<float, 3>(aRay.myOrigin, preDivedRayDir, poly.myShape.myBoundingBox))
+			continue;
+
+		for (const fisk::tools::Tri<float>& tri : poly.myShape.myTris)
+		{
+			if (fisk::tools::Intersect(aRay, tri))
+				return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,163 @@
+#include "MpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	void SingleThread()
+	{
+		MpscQueue<int> queue(5);
+
+		Check(queue.GetCapacity() == 8, "the capacity is rounded up to a power of two");
+
+		for (int i = 0; i < 8; i++)
+			Check(queue.Push(int(i)), "pushes succeed up to the capacity");
+
+		Check(!queue.Push(8), "a push into a full queue fails");
+
+		int value = -1;
+		Check(queue.Pop(value) && value == 0, "the first value pushed is popped first");
+		Check(queue.Push(8), "popping makes room for another push");
+
+		std::vector<int> out(16);
+		Check(queue.PopBulk(out) == 8, "a bulk pop takes everything there is");
+
+		bool inOrder = true;
+		for (int i = 0; i < 8; i++)
+			inOrder &= out[i] == i + 1;
+
+		Check(inOrder, "a bulk pop keeps the push order");
+		Check(!queue.Pop(value), "an empty queue pops nothing");
+	}
+
+	void ManyProducers()
+	{
+		constexpr uint64_t Producers = 4;
+		constexpr uint64_t PerProducer = 100000;
+
+		// small so the producers keep running into a full queue
+		MpscQueue<uint64_t> queue(64);
+
+		std::vector<std::thread> producers;
+
+		for (uint64_t producer = 0; producer < Producers; producer++)
+		{
+			producers.emplace_back([&queue, producer]()
+			{
+				for (uint64_t i = 0; i < PerProducer; i++)
+					queue.PushWait(producer << 32 | i, []() { return false; });
+			});
+		}
+
+		std::vector<uint64_t> next(Producers, 0);
+		uint64_t received = 0;
+		bool inOrder = true;
+
+		std::vector<uint64_t> out(32);
+
+		while (received < Producers * PerProducer)
+		{
+			size_t count = queue.PopBulk(out);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				uint64_t producer = out[i] >> 32;
+				uint64_t sequence = out[i] & 0xFFFFFFFF;
+
+				inOrder &= producer < Producers && sequence == next[producer];
+
+				if (producer < Producers)
+					next[producer] = sequence + 1;
+			}
+
+			received += count;
+		}
+
+		for (std::thread& producer : producers)
+			producer.join();
+
+		uint64_t extra;
+
+		Check(inOrder, "every producer's values come out in the order it pushed them");
+		Check(received == Producers * PerProducer, "every value pushed is popped");
+		Check(!queue.Pop(extra), "nothing is popped twice");
+	}
+
+	void PushWaitBlocksUntilThereIsRoom()
+	{
+		MpscQueue<int> queue(2);
+		queue.Push(0);
+		queue.Push(1);
+
+		std::atomic<bool> pushed = false;
+
+		std::thread producer([&queue, &pushed]()
+		{
+			queue.PushWait(2, []() { return false; });
+			pushed = true;
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		Check(!pushed, "a push into a full queue waits");
+
+		int value;
+		queue.Pop(value);
+		producer.join();
+
+		Check(pushed, "the waiting push goes through once there is room");
+		Check(queue.Pop(value) && value == 1 && queue.Pop(value) && value == 2, "the waiting push lands behind what was there");
+	}
+
+	void PushWaitGivesUp()
+	{
+		MpscQueue<int> queue(1);
+
+		Check(queue.GetCapacity() == 2, "a queue has at least two cells");
+
+		queue.Push(0);
+		queue.Push(1);
+
+		std::atomic<bool> cancelled = false;
+		std::atomic<bool> result = true;
+
+		std::thread producer([&queue, &cancelled, &result]()
+		{
+			result = queue.PushWait(2, [&cancelled]() { return cancelled.load(); });
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		cancelled = true;
+		producer.join();
+
+		int value;
+
+		Check(!result, "a waiting push gives up when asked to");
+		Check(queue.Pop(value) && value == 0 && queue.Pop(value) && value == 1 && !queue.Pop(value), "a push that gave up leaves the queue as it was");
+	}
+}
+
+int main()
+{
+	SingleThread();
+	ManyProducers();
+	PushWaitBlocksUntilThereIsRoom();
+	PushWaitGivesUp();
+
+	return globalFailures == 0 ? 0 : 1;
+}
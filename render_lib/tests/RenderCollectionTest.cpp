@@ -0,0 +1,175 @@
+#include "RenderCollection.h"
+
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	/// Holds up to a capacity of texels and finishes a fixed number of them every Update
+	class FakeRenderer : public IAsyncRenderer<float>
+	{
+	public:
+		FakeRenderer(size_t aCapacity, size_t aTexelsPerUpdate)
+			: myCapacity(aCapacity)
+			, myTexelsPerUpdate(aTexelsPerUpdate)
+		{
+		}
+
+		bool CanRender(fisk::tools::V2ui aUV) override
+		{
+			return myQueued.size() < myCapacity;
+		}
+
+		void Render(fisk::tools::V2ui aUV) override
+		{
+			myQueued.push_back(aUV);
+		}
+
+		bool GetResult(Result& aOut) override
+		{
+			if (myDone.empty())
+				return false;
+
+			aOut = { myDone.front(), 1.f };
+			myDone.pop_front();
+			return true;
+		}
+
+		size_t GetPending() override
+		{
+			return myQueued.size() + myDone.size();
+		}
+
+		void Update() override
+		{
+			if (myQueued.empty())
+				myIdleUpdates++;
+
+			for (size_t i = 0; i < myTexelsPerUpdate && !myQueued.empty(); i++)
+			{
+				myDone.push_back(myQueued.front());
+				myQueued.pop_front();
+				myCompleted++;
+			}
+		}
+
+		size_t myCapacity;
+		size_t myTexelsPerUpdate;
+
+		size_t myCompleted = 0;
+		size_t myIdleUpdates = 0;
+
+	private:
+		std::deque<fisk::tools::V2ui> myQueued;
+		std::deque<fisk::tools::V2ui> myDone;
+	};
+
+	using Collection = RenderCollection<float>;
+
+	struct Setup
+	{
+		Setup(Collection::DispatchPolicy aPolicy)
+		{
+			Collection::CollectionType renderers;
+
+			renderers.push_back(std::make_unique<FakeRenderer>(16, 1));
+			renderers.push_back(std::make_unique<FakeRenderer>(16, 16));
+
+			mySlow = static_cast<FakeRenderer*>(renderers[0].get());
+			myFast = static_cast<FakeRenderer*>(renderers[1].get());
+
+			myCollection = std::make_unique<Collection>(std::move(renderers), aPolicy);
+		}
+
+		/// Keeps the collection as full as it will take, like the orchestrator does
+		void Run(size_t aUpdates)
+		{
+			std::vector<fisk::tools::V2ui> work(64, fisk::tools::V2ui{ 0, 0 });
+			std::vector<IAsyncRenderer<float>::Result> results(64);
+
+			for (size_t i = 0; i < aUpdates; i++)
+			{
+				myCollection->RenderBatch(work);
+				myCollection->Update();
+
+				while (myCollection->GetResults(results) > 0)
+				{
+				}
+			}
+		}
+
+		std::unique_ptr<Collection> myCollection;
+		FakeRenderer* mySlow;
+		FakeRenderer* myFast;
+	};
+
+	void FastIsNotStarved(Collection::DispatchPolicy aPolicy, const char* aName)
+	{
+		Setup setup(aPolicy);
+		setup.Run(100);
+
+		std::cout << aName << ": fast " << setup.myFast->myCompleted << " slow " << setup.mySlow->myCompleted << "\n";
+
+		Check(setup.myFast->myIdleUpdates == 0, "the fast renderer is never left idle next to the slow one");
+		Check(setup.mySlow->myIdleUpdates == 0, "the slow renderer is kept busy too");
+		Check(setup.myFast->myCompleted >= setup.mySlow->myCompleted * 8, "the fast renderer finishes most of the work");
+		Check(setup.myCollection->GetPending() == setup.myFast->GetPending() + setup.mySlow->GetPending(), "pending matches the sub renderers");
+	}
+
+	void FullCollectionRefuses(Collection::DispatchPolicy aPolicy)
+	{
+		Setup setup(aPolicy);
+
+		std::vector<fisk::tools::V2ui> work(64, fisk::tools::V2ui{ 0, 0 });
+
+		Check(setup.myCollection->RenderBatch(work) == 32, "a batch fills every renderer up to its capacity");
+		Check(!setup.myCollection->CanRender({ 0, 0 }), "a full collection can not render");
+		Check(setup.myCollection->RenderBatch(work) == 0, "a full collection takes nothing");
+		Check(setup.myCollection->GetPending() == 32, "everything taken is pending");
+	}
+}
+
+int main()
+{
+	const std::pair<Collection::DispatchPolicy, const char*> policies[] = {
+		{ Collection::DispatchPolicy::RoundRobin, "round robin" },
+		{ Collection::DispatchPolicy::LeastOutstanding, "least outstanding" },
+		{ Collection::DispatchPolicy::PowerOfTwoChoices, "power of two choices" },
+		{ Collection::DispatchPolicy::ThroughputWeighted, "throughput weighted" }
+	};
+
+	for (auto [policy, name] : policies)
+	{
+		FastIsNotStarved(policy, name);
+		FullCollectionRefuses(policy);
+	}
+
+	{
+		Collection collection(Collection::CollectionType{}, Collection::DispatchPolicy::LeastOutstanding);
+
+		Check(!collection.CanRender({ 0, 0 }), "an empty collection can not render");
+		Check(collection.RenderBatch(std::vector<fisk::tools::V2ui>(4)) == 0, "an empty collection takes nothing");
+	}
+
+	{
+		Setup setup(Collection::DispatchPolicy::RoundRobin);
+
+		setup.myCollection->SetPolicy(Collection::DispatchPolicy::ThroughputWeighted);
+		Check(setup.myCollection->GetPolicy() == Collection::DispatchPolicy::ThroughputWeighted, "the policy can be changed per collection");
+	}
+
+	return globalFailures == 0 ? 0 : 1;
+}
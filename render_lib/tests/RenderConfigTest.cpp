@@ -0,0 +1,67 @@
+#include "RenderConfig.h"
+
+#include <iostream>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	RenderConfig Config(size_t aSamplesPerTexel, size_t aSamplesPerPass)
+	{
+		RenderConfig config{};
+		config.mySamplesPerTexel = aSamplesPerTexel;
+		config.mySamplesPerPass = aSamplesPerPass;
+
+		return config;
+	}
+}
+
+int main()
+{
+	{
+		RenderConfig config = Config(400, 64);
+
+		Check(!config.IsValid(), "400 samples in passes of 64 is rejected");
+	}
+
+	{
+		RenderConfig config = Config(400, 16);
+
+		Check(config.IsValid(), "400 samples in passes of 16 is valid");
+		Check(config.GetPasses() == 25, "400 samples in passes of 16 is 25 passes");
+		Check(config.GetPasses() * config.GetSamplesPerPass() == 400, "passes of 16 render exactly 400 samples");
+	}
+
+	{
+		RenderConfig config = Config(400, 0);
+
+		Check(config.IsValid(), "no samples per pass is valid");
+		Check(config.GetPasses() == 1, "no samples per pass renders a single pass");
+		Check(config.GetSamplesPerPass() == 400, "a single pass renders every sample");
+	}
+
+	{
+		RenderConfig config = Config(100, 400);
+
+		Check(config.IsValid(), "more samples per pass than per texel is valid");
+		Check(config.GetPasses() == 1, "more samples per pass than per texel renders a single pass");
+		Check(config.GetSamplesPerPass() == 100, "a pass never renders more than the samples per texel");
+	}
+
+	{
+		RenderConfig config = Config(0, 0);
+
+		Check(!config.IsValid(), "zero samples per texel is rejected");
+	}
+
+	return globalFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#include "RenderMessages.h"
+
+#include <iostream>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	using Texel = TextureType::PackedValues;
+
+	Texel MakeTexel(float aValue)
+	{
+		return { fisk::tools::V3f{ aValue, aValue * 2.f, aValue * 3.f }, CompactNanoSecond(aValue), 1u, 2u, 3u };
+	}
+
+	void FullTexels()
+	{
+		ResultBatch<Texel> batch;
+
+		ResultMessage<Texel> texel;
+		texel.myTexel = { fisk::tools::V2ui{ 3, 4 }, MakeTexel(0.5f) };
+		batch.Add(texel);
+
+		ResultMessage<Texel> tile;
+		tile.myKind = RenderRequest::Tile;
+		tile.myRect = { { 8, 16 }, { 2, 3 } };
+
+		for (size_t i = 0; i < tile.myRect.Area(); i++)
+			tile.myTexels.push_back(MakeTexel(static_cast<float>(i)));
+
+		batch.Add(tile);
+
+		Check(batch.GetCount() == 2, "the batch counts its messages");
+
+		ResultMessage<Texel> read;
+
+		Check(batch.Next(read), "a texel is read back");
+		Check(read.myKind == RenderRequest::Texel, "the texel keeps its kind");
+		Check(read.myTexel.first == fisk::tools::V2ui{ 3, 4 } && read.myTexel.second == MakeTexel(0.5f), "the texel is read back unchanged");
+
+		Check(batch.Next(read), "a tile is read back");
+		Check(read.myKind == RenderRequest::Tile, "the tile keeps its kind");
+		Check(read.myRect.myOrigin == tile.myRect.myOrigin && read.myRect.mySize == tile.myRect.mySize, "the tile keeps its rect");
+		Check(read.myTexels == tile.myTexels, "the tile texels are read back unchanged");
+
+		Check(!batch.Next(read), "nothing is read past the end");
+		Check(batch.IsFullyRead(), "every byte is used");
+	}
+
+	void CompactTexels()
+	{
+		ResultBatch<Texel> batch;
+
+		ResultMessage<Texel> tile;
+		tile.myKind = RenderRequest::Tile;
+		tile.myEncoding = RenderConfig::CompactTexels;
+		tile.myRect = { { 0, 0 }, { 4, 1 } };
+		tile.myCompactTexels.resize(4);
+		tile.myCompactTexels[2].myColor = 1234;
+
+		batch.Add(tile);
+
+		ResultMessage<Texel> read;
+		read.myEncoding = RenderConfig::CompactTexels;
+
+		Check(batch.Next(read), "a compact tile is read back");
+		Check(read.myCompactTexels.size() == 4 && read.myCompactTexels[2].myColor == 1234, "compact texels are read back unchanged");
+		Check(batch.IsFullyRead(), "a compact tile uses every byte");
+	}
+
+	void OversizedTile()
+	{
+		ResultBatch<Texel> batch;
+
+		ResultMessage<Texel> tile;
+		tile.myKind = RenderRequest::Tile;
+		tile.myRect = { { 0, 0 }, { 4, 4 } };
+		tile.myTexels.resize(16);
+
+		batch.Add(tile);
+
+		ResultMessage<Texel> read;
+		read.myMaxArea = 8;
+
+		Check(!batch.Next(read), "a tile larger than what was asked for is rejected");
+		Check(!batch.IsFullyRead(), "a rejected tile leaves bytes unread");
+	}
+}
+
+int main()
+{
+	FullTexels();
+	CompactTexels();
+	OversizedTile();
+
+	return globalFailures == 0 ? 0 : 1;
+}
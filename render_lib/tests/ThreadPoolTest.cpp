@@ -0,0 +1,265 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	/// Polls aCondition for a few seconds so a broken pool fails the test instead of hanging it
+	template<class Condition>
+	bool WaitFor(Condition&& aCondition)
+	{
+		auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+		while (!aCondition())
+		{
+			if (std::chrono::steady_clock::now() > giveUp)
+				return false;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		return true;
+	}
+
+	/// Parks one task on every worker so the test decides when each of them gets to look at its queue again
+	class Gates
+	{
+	public:
+		Gates(ThreadPool& aPool)
+			: myPool(aPool)
+			, myReleased(aPool.GetThreadCount())
+		{
+			// a worker sits in the first gate it picks up, so every gate ends up on its own worker
+			for (size_t i = 0; i < aPool.GetThreadCount(); i++)
+			{
+				aPool.Submit([this]()
+				{
+					std::atomic<bool>& released = myReleased[*myPool.CurrentWorker()];
+
+					myStarted++;
+					released.wait(false);
+					myLeft++;
+				});
+			}
+
+			Check(WaitFor([this]() { return myStarted == myPool.GetThreadCount(); }), "every worker picks up a gate");
+		}
+
+		~Gates()
+		{
+			for (size_t i = 0; i < myReleased.size(); i++)
+				Release(i);
+
+			// the workers are still looking at the flags on their way out
+			WaitFor([this]() { return myLeft == myStarted; });
+		}
+
+		void Release(size_t aWorker)
+		{
+			myReleased[aWorker] = true;
+			myReleased[aWorker].notify_all();
+		}
+
+	private:
+		ThreadPool& myPool;
+		std::atomic<size_t> myStarted = 0;
+		std::atomic<size_t> myLeft = 0;
+		std::vector<std::atomic<bool>> myReleased;
+	};
+
+	/// Which worker ran what, in the order they ran
+	struct Log
+	{
+		void Add(int aTask, size_t aWorker)
+		{
+			std::lock_guard lock(myMutex);
+			myEntries.emplace_back(aTask, aWorker);
+		}
+
+		size_t Size()
+		{
+			std::lock_guard lock(myMutex);
+			return myEntries.size();
+		}
+
+		std::pair<int, size_t> At(size_t aIndex)
+		{
+			std::lock_guard lock(myMutex);
+			return myEntries[aIndex];
+		}
+
+		std::mutex myMutex;
+		std::vector<std::pair<int, size_t>> myEntries;
+	};
+
+	void AllTasksRun()
+	{
+		constexpr size_t Submitters = 4;
+		constexpr size_t PerSubmitter = 10000;
+
+		std::atomic<size_t> ran = 0;
+
+		{
+			ThreadPool pool(4);
+
+			std::vector<std::thread> submitters;
+
+			for (size_t i = 0; i < Submitters; i++)
+			{
+				submitters.emplace_back([&pool, &ran]()
+				{
+					for (size_t i = 0; i < PerSubmitter; i++)
+						pool.Submit([&ran]() { ran++; });
+				});
+			}
+
+			for (std::thread& submitter : submitters)
+				submitter.join();
+
+			Check(WaitFor([&ran]() { return ran == Submitters * PerSubmitter; }), "every task submitted runs");
+		}
+
+		Check(ran == Submitters * PerSubmitter, "no task runs twice");
+	}
+
+	void StealFromBack()
+	{
+		ThreadPool pool(2);
+		Log log;
+		std::atomic<bool> finished = false;
+
+		{
+			Gates gates(pool);
+
+			auto task = [&pool, &log, &finished](int aTask)
+			{
+				return [&pool, &log, &finished, aTask]()
+				{
+					size_t worker = *pool.CurrentWorker();
+					log.Add(aTask, worker);
+
+					// the first task runs a child, it goes on the same worker's queue behind the others
+					if (aTask == 0)
+						pool.Submit([&pool, &log]() { log.Add(4, *pool.CurrentWorker()); });
+
+					// keep the thief out of the way once it has stolen one
+					if (worker == 1)
+						finished.wait(false);
+				};
+			};
+
+			// affinities past the thread count wrap around, these all land on worker 0
+			for (int i = 0; i < 4; i++)
+				pool.Submit(task(i), i * 2);
+
+			gates.Release(1);
+			Check(WaitFor([&log]() { return log.Size() == 1; }), "an idle worker steals");
+			Check(log.At(0) == std::pair<int, size_t>{ 3, 1 }, "the thief takes the task the owner would run last");
+
+			gates.Release(0);
+			Check(WaitFor([&log]() { return log.Size() == 5; }), "the owner runs the rest");
+			Check(log.At(1) == std::pair<int, size_t>{ 0, 0 }, "the owner runs its own queue from the front");
+			Check(log.At(2) == std::pair<int, size_t>{ 1, 0 } && log.At(3) == std::pair<int, size_t>{ 2, 0 }, "the owner runs its own queue in submission order");
+			Check(log.At(4) == std::pair<int, size_t>{ 4, 0 }, "a task submitted from a worker runs on that worker");
+
+			finished = true;
+			finished.notify_all();
+		}
+	}
+
+	void Affinity()
+	{
+		ThreadPool pool(NumaTopology::SingleDomain(8), 3, false);
+
+		Check(pool.GetThreadCount() == 3, "the pool has the threads asked for");
+		Check(pool.GetDomainCount() == 1, "a single domain topology makes a single domain pool");
+		Check(pool.GetDomainOf(2) == 0, "every worker is in the only domain");
+		Check(pool.GetDomainCpus(0).empty(), "unpinned workers have no cpus");
+		Check(!pool.CurrentWorker(), "the test thread is not a worker");
+
+		Log log;
+		std::atomic<bool> finished = false;
+
+		{
+			Gates gates(pool);
+
+			auto task = [&pool, &log, &finished](int aTask)
+			{
+				return [&pool, &log, &finished, aTask]()
+				{
+					log.Add(aTask, *pool.CurrentWorker());
+					finished.wait(false);
+				};
+			};
+
+			// every worker has exactly one task of its own, it pops that before it looks at anyone else's
+			pool.Submit(task(0), 3);
+			pool.Submit(task(1), 1);
+			pool.SubmitToDomain(task(2), 0, 5);
+		}
+
+		Check(WaitFor([&log]() { return log.Size() == 3; }), "every placed task runs");
+
+		bool placed = true;
+		for (size_t i = 0; i < 3; i++)
+			placed &= log.At(i).second == static_cast<size_t>(log.At(i).first);
+
+		Check(placed, "tasks run on the worker their affinity picks");
+
+		finished = true;
+		finished.notify_all();
+	}
+
+	void DestructorDrains()
+	{
+		constexpr size_t Tasks = 1000;
+
+		std::atomic<size_t> ran = 0;
+
+		{
+			ThreadPool pool(2);
+
+			for (size_t i = 0; i < Tasks; i++)
+			{
+				pool.Submit([&pool, &ran]()
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(10));
+
+					// work queued while the pool is stopping still runs
+					pool.Submit([&ran]() { ran++; });
+					ran++;
+				});
+			}
+		}
+
+		Check(ran == Tasks * 2, "the destructor runs everything queued before joining");
+	}
+}
+
+int main()
+{
+	AllTasksRun();
+	StealFromBack();
+	Affinity();
+	DestructorDrains();
+
+	return globalFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+#include "EventLoop.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+EventLoop::EventLoop()
+	: myNextTimerId(0)
+	, myWakePending(false)
+	, myIsStopping(false)
+{
+#ifdef __linux__
+	myEpoll = epoll_create1(EPOLL_CLOEXEC);
+	myWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	assert(myEpoll != -1 && myWakeFd != -1);
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.fd = myWakeFd;
+
+	epoll_ctl(myEpoll, EPOLL_CTL_ADD, myWakeFd, &event);
+#endif
+}
+
+EventLoop::~EventLoop()
+{
+#ifdef __linux__
+	close(myWakeFd);
+	close(myEpoll);
+#endif
+}
+
+void EventLoop::Wake()
+{
+	// only the first wake since the loop last looked goes through the kernel
+	if (myWakePending.exchange(true, std::memory_order_acq_rel))
+		return;
+
+#ifdef __linux__
+	uint64_t one = 1;
+	[[maybe_unused]] ssize_t written = write(myWakeFd, &one, sizeof(one));
+#else
+	std::lock_guard lock(myMutex);
+	myCondition.notify_one();
+#endif
+}
+
+void EventLoop::Stop()
+{
+	myIsStopping = true;
+
+	// Wake may be skipped if one is already pending, the loop sees the flag on that round anyway
+	Wake();
+}
+
+void EventLoop::OnWake(Callback aCallback)
+{
+	myWakeCallbacks.push_back(std::move(aCallback));
+}
+
+EventLoop::TimerId EventLoop::AddTimer(std::chrono::microseconds aInterval, Callback aCallback)
+{
+	TimerId id = myNextTimerId++;
+
+	myTimers.push_back({ id, aInterval, Clock::now() + aInterval, std::move(aCallback) });
+
+	return id;
+}
+
+void EventLoop::SetInterval(TimerId aTimer, std::chrono::microseconds aInterval)
+{
+	Timer* timer = FindTimer(aTimer);
+
+	if (!timer)
+		return;
+
+	// keep the time of the last run, so shortening the interval can make the timer due right away
+	timer->myNext = timer->myNext - timer->myInterval + aInterval;
+	timer->myInterval = aInterval;
+}
+
+EventLoop::TimerId EventLoop::AddTimeout(Clock::time_point aTime, Callback aCallback)
+{
+	TimerId id = myNextTimerId++;
+
+	myTimers.push_back({ id, std::chrono::microseconds::zero(), aTime, std::move(aCallback) });
+
+	return id;
+}
+
+void EventLoop::RemoveTimer(TimerId aTimer)
+{
+	myTimers.erase(std::remove_if(myTimers.begin(), myTimers.end(), [aTimer](const Timer& aOther) { return aOther.myId == aTimer; }), myTimers.end());
+}
+
+void EventLoop::Run()
+{
+	while (!myIsStopping)
+	{
+		Clock::time_point deadline = Clock::time_point::max();
+
+		for (const Timer& timer : myTimers)
+			deadline = std::min(deadline, timer.myNext);
+
+		if (WaitUntil(deadline))
+		{
+			for (Callback& callback : myWakeCallbacks)
+				callback();
+		}
+
+		RunDueTimers();
+	}
+}
+
+bool EventLoop::WaitUntil(Clock::time_point aDeadline)
+{
+	if (myWakePending.exchange(false, std::memory_order_acq_rel))
+		return true;
+
+#ifdef __linux__
+	int timeout = -1;
+
+	if (aDeadline != Clock::time_point::max())
+	{
+		Clock::duration left = aDeadline - Clock::now();
+
+		// round up, waking before the timer is due would just be another round trip through epoll
+		timeout = left <= Clock::duration::zero() ? 0 : static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(left).count());
+	}
+
+	epoll_event event;
+
+	if (epoll_wait(myEpoll, &event, 1, timeout) > 0)
+	{
+		uint64_t count;
+		[[maybe_unused]] ssize_t got = read(myWakeFd, &count, sizeof(count));
+	}
+#else
+	std::unique_lock lock(myMutex);
+
+	auto woken = [this]() { return myWakePending.load(std::memory_order_acquire); };
+
+	if (aDeadline == Clock::time_point::max())
+		myCondition.wait(lock, woken);
+	else
+		myCondition.wait_until(lock, aDeadline, woken);
+#endif
+
+	// drained before clearing the flag, a wake landing in between is still seen on this round
+	return myWakePending.exchange(false, std::memory_order_acq_rel);
+}
+
+void EventLoop::RunDueTimers()
+{
+	Clock::time_point now = Clock::now();
+
+	// by id, callbacks may add or remove timers and invalidate references into myTimers
+	std::vector<TimerId> due;
+
+	for (const Timer& timer : myTimers)
+	{
+		if (timer.myNext <= now)
+			due.push_back(timer.myId);
+	}
+
+	for (TimerId id : due)
+	{
+		Timer* timer = FindTimer(id);
+
+		if (!timer)
+			continue;
+
+		Callback callback = timer->myCallback;
+
+		if (timer->myInterval == std::chrono::microseconds::zero())
+			RemoveTimer(id);
+		else
+			timer->myNext = now + timer->myInterval;
+
+		callback();
+	}
+}
+
+EventLoop::Timer* EventLoop::FindTimer(TimerId aTimer)
+{
+	for (Timer& timer : myTimers)
+	{
+		if (timer.myId == aTimer)
+			return &timer;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// Sleeps until it is woken or a timer is due, epoll on an eventfd on linux and a condition variable elsewhere
+/// Everything but Wake and Stop is for the thread calling Run
+class EventLoop
+{
+public:
+	using Callback = std::function<void()>;
+	using TimerId = uint64_t;
+	using Clock = std::chrono::steady_clock;
+
+	EventLoop();
+	~EventLoop();
+
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	/// Thread safe, wakes that come in while the loop is already awake are merged into one
+	void Wake();
+
+	/// Thread safe, Run returns once the current round is done
+	void Stop();
+
+	/// Run after every wake
+	void OnWake(Callback aCallback);
+
+	/// Repeats every aInterval until removed, the first call is one interval from now
+	TimerId AddTimer(std::chrono::microseconds aInterval, Callback aCallback);
+	void SetInterval(TimerId aTimer, std::chrono::microseconds aInterval);
+
+	/// Runs once at aTime and is removed before it is called, RemoveTimer cancels it
+	TimerId AddTimeout(Clock::time_point aTime, Callback aCallback);
+
+	void RemoveTimer(TimerId aTimer);
+
+	void Run();
+
+private:
+	struct Timer
+	{
+		TimerId myId;
+		std::chrono::microseconds myInterval; // zero for a timeout
+		Clock::time_point myNext;
+		Callback myCallback;
+	};
+
+	/// Returns true if woken rather than timed out
+	bool WaitUntil(Clock::time_point aDeadline);
+	void RunDueTimers();
+
+	Timer* FindTimer(TimerId aTimer);
+
+	std::vector<Callback> myWakeCallbacks;
+	std::vector<Timer> myTimers;
+	TimerId myNextTimerId;
+
+	std::atomic<bool> myWakePending;
+	std::atomic<bool> myIsStopping;
+
+#ifdef __linux__
+	int myEpoll;
+	int myWakeFd;
+#else
+	std::mutex myMutex;
+	std::condition_variable myCondition;
+#endif
+};
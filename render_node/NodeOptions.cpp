@@ -0,0 +1,100 @@
+#include "NodeOptions.h"
+
+#include <exception>
+#include <iostream>
+
+std::optional<NodeOptions> NodeOptions::Parse(int aArgc, char** aArgv)
+{
+	NodeOptions out;
+
+	for (int i = 1; i < aArgc; i++)
+	{
+		std::string argument = aArgv[i];
+
+		if (argument == "--help")
+		{
+			std::cout << Usage();
+			return {};
+		}
+
+		if (i + 1 >= aArgc)
+		{
+			std::cout << "Missing value for " << argument << "\n" << Usage();
+			return {};
+		}
+
+		std::string value = aArgv[++i];
+
+		if (argument == "--numa")
+		{
+			if (value == "off")
+				out.myNumaMode = NumaMode::Off;
+			else if (value == "pin")
+				out.myNumaMode = NumaMode::Pin;
+			else if (value == "replicate")
+				out.myNumaMode = NumaMode::Replicate;
+			else
+			{
+				std::cout << "Unknown numa mode: " << value << "\n" << Usage();
+				return {};
+			}
+		}
+		else if (argument == "--threads" || argument == "--max-pending")
+		{
+			std::optional<size_t> count = ParseCount(argument, value);
+
+			if (!count)
+				return {};
+
+			(argument == "--threads" ? out.myThreads : out.myMaxPending) = count;
+		}
+		else if (argument == "--max-sessions")
+		{
+			std::optional<size_t> count = ParseCount(argument, value);
+
+			if (!count)
+				return {};
+
+			out.myMaxSessions = *count;
+		}
+		else
+		{
+			std::cout << "Unknown argument: " << argument << "\n" << Usage();
+			return {};
+		}
+	}
+
+	return out;
+}
+
+std::string NodeOptions::Usage()
+{
+	return "Usage: render_node [options]\n"
+		"  --numa off|pin|replicate    thread placement on NUMA machines, defaults to replicate\n"
+		"  --threads <count>           worker threads, defaults to the cpus the affinity mask and cgroup quota allow minus one\n"
+		"  --max-pending <count>       texels a session may have in flight, defaults to what measured throughput calls for\n"
+		"  --max-sessions <count>      sessions rendering at once, later ones are queued, defaults to 4\n";
+}
+
+std::optional<size_t> NodeOptions::ParseCount(const std::string& aArgument, const std::string& aValue)
+{
+	size_t end = 0;
+	unsigned long long value = 0;
+
+	try
+	{
+		value = std::stoull(aValue, &end);
+	}
+	catch (const std::exception&)
+	{
+		end = 0;
+	}
+
+	if (end == 0 || end != aValue.size() || value == 0)
+	{
+		std::cout << aArgument << " expects a positive number, got: " << aValue << "\n" << Usage();
+		return {};
+	}
+
+	return static_cast<size_t>(value);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+/// Node wide settings, given on the command line
+struct NodeOptions
+{
+	enum class NumaMode
+	{
+		Off,		// one flat pool, threads float freely
+		Pin,		// workers pinned to their domain's cpus, sessions share a single scene
+		Replicate	// pinned, and every domain gets its own copy of the scene and acceleration structure
+	};
+
+	NumaMode myNumaMode = NumaMode::Replicate;
+
+	// override what the node works out from its affinity mask, cgroup quota and measured throughput
+	std::optional<size_t> myThreads;
+	std::optional<size_t> myMaxPending;
+
+	size_t myMaxSessions = 4; // sessions rendering at once, later ones wait in line
+
+	/// Prints the problem and the usage and returns nothing on bad arguments
+	static std::optional<NodeOptions> Parse(int aArgc, char** aArgv);
+
+	static std::string Usage();
+
+private:
+	static std::optional<size_t> ParseCount(const std::string& aArgument, const std::string& aValue);
+};
@@ -0,0 +1,137 @@
+#include "NodeScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+NodeScheduler::NodeScheduler(const NumaTopology& aTopology, size_t aThreadCount, bool aPinThreads, size_t aMaxActiveSessions)
+	: myPool(aTopology, aThreadCount, aPinThreads)
+	, myMaxActiveSessions(std::max<size_t>(aMaxActiveSessions, 1))
+	, myTotalWeight(0)
+	, myNextId(0)
+{
+}
+
+ThreadPool& NodeScheduler::GetPool()
+{
+	return myPool;
+}
+
+NodeScheduler::SessionId NodeScheduler::Enqueue(uint32_t aWeight)
+{
+	std::lock_guard lock(myMutex);
+
+	SessionId id = myNextId++;
+
+	myWaiting.push_back({ id, std::max<uint32_t>(aWeight, 1) });
+	AdmitWaiting();
+
+	return id;
+}
+
+void NodeScheduler::Leave(SessionId aSession)
+{
+	std::lock_guard lock(myMutex);
+
+	auto matches = [aSession](const Session& aOther) { return aOther.myId == aSession; };
+
+	if (auto active = std::find_if(myActive.begin(), myActive.end(), matches); active != myActive.end())
+	{
+		myTotalWeight -= active->myWeight;
+		myActive.erase(active);
+	}
+	else if (auto waiting = std::find_if(myWaiting.begin(), myWaiting.end(), matches); waiting != myWaiting.end())
+	{
+		myWaiting.erase(waiting);
+	}
+
+	AdmitWaiting();
+}
+
+bool NodeScheduler::IsAdmitted(SessionId aSession) const
+{
+	std::lock_guard lock(myMutex);
+
+	return std::any_of(myActive.begin(), myActive.end(), [aSession](const Session& aOther) { return aOther.myId == aSession; });
+}
+
+size_t NodeScheduler::GetQueuePosition(SessionId aSession) const
+{
+	std::lock_guard lock(myMutex);
+
+	for (size_t i = 0; i < myWaiting.size(); i++)
+	{
+		if (myWaiting[i].myId == aSession)
+			return i + 1;
+	}
+
+	return 0;
+}
+
+float NodeScheduler::GetShare(SessionId aSession) const
+{
+	std::lock_guard lock(myMutex);
+
+	for (const Session& session : myActive)
+	{
+		if (session.myId == aSession)
+			return std::min(1.f, static_cast<float>(session.myWeight) / static_cast<float>(myTotalWeight) * session.myCorrection);
+	}
+
+	return 0.f;
+}
+
+void NodeScheduler::ReportBusyTime(SessionId aSession, std::chrono::nanoseconds aBusyTime)
+{
+	std::lock_guard lock(myMutex);
+
+	auto session = std::find_if(myActive.begin(), myActive.end(), [aSession](const Session& aOther) { return aOther.myId == aSession; });
+
+	if (session == myActive.end())
+		return;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (now - session->myReportedAt < RateWindow)
+		return;
+
+	float rate = std::chrono::duration<float>(aBusyTime - session->myReportedBusy).count() / std::chrono::duration<float>(now - session->myReportedAt).count();
+
+	session->myBusyRate = session->myBusyRate ? *session->myBusyRate + (rate - *session->myBusyRate) * RateSmoothing : rate;
+	session->myReportedAt = now;
+	session->myReportedBusy = aBusyTime;
+
+	float totalRate = 0.f;
+	size_t measured = 0;
+
+	for (const Session& other : myActive)
+	{
+		if (!other.myBusyRate)
+			continue;
+
+		totalRate += *other.myBusyRate;
+		measured++;
+	}
+
+	// alone on the node, or nobody is rendering, there is nothing to be fair against
+	if (measured < 2 || totalRate <= 0.f)
+		return;
+
+	float target = static_cast<float>(session->myWeight) / static_cast<float>(myTotalWeight);
+	float used = std::max(*session->myBusyRate / totalRate, target * MinCorrection);
+
+	// square root so the cap walks towards the target over a few windows instead of overshooting it, the texels
+	// already in flight take a while to show up in the busy time
+	session->myCorrection = std::clamp(session->myCorrection * std::sqrt(target / used), MinCorrection, MaxCorrection);
+}
+
+// called with myMutex held
+void NodeScheduler::AdmitWaiting()
+{
+	while (!myWaiting.empty() && myActive.size() < myMaxActiveSessions)
+	{
+		myTotalWeight += myWaiting.front().myWeight;
+		myActive.push_back(myWaiting.front());
+		myActive.back().myReportedAt = std::chrono::steady_clock::now();
+		myWaiting.pop_front();
+	}
+}
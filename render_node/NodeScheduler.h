@@ -0,0 +1,76 @@
+#pragma once
+
+#include "NumaTopology.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/// Owns the node's worker pool and decides which sessions get to use it
+/// A limited number of sessions run at once, each gets a slice of the pool in proportion to its weight,
+/// the rest wait in line in the order they arrived. Thread safe, every session calls in from its own thread
+class NodeScheduler
+{
+public:
+	using SessionId = uint64_t;
+
+	NodeScheduler(const NumaTopology& aTopology, size_t aThreadCount, bool aPinThreads, size_t aMaxActiveSessions);
+
+	ThreadPool& GetPool();
+
+	/// Queues a session, it may be admitted right away
+	SessionId Enqueue(uint32_t aWeight);
+
+	/// Call for queued and admitted sessions alike, the next in line is admitted if there is room
+	void Leave(SessionId aSession);
+
+	bool IsAdmitted(SessionId aSession) const;
+
+	/// Place in line counting from 1, 0 once admitted
+	size_t GetQueuePosition(SessionId aSession) const;
+
+	/// Fraction of the node's pending texels this session may keep in flight, it changes as other sessions come and go
+	/// Starts out as the session's weighted share of the pool and is then corrected by the busy time sessions report,
+	/// so a session with more samples per texel gets fewer texels rather than more of the pool
+	float GetShare(SessionId aSession) const;
+
+	/// aBusyTime is the session's total time spent rendering on the pool so far
+	void ReportBusyTime(SessionId aSession, std::chrono::nanoseconds aBusyTime);
+
+private:
+	struct Session
+	{
+		SessionId myId;
+		uint32_t myWeight;
+
+		std::chrono::steady_clock::time_point myReportedAt;
+		std::chrono::nanoseconds myReportedBusy = std::chrono::nanoseconds::zero();
+		std::optional<float> myBusyRate;	// pool threads kept busy, smoothed over reports
+		float myCorrection = 1.f;
+	};
+
+	// busy time is only turned into a rate over at least this long, shorter gaps are mostly noise from task granularity
+	static constexpr std::chrono::milliseconds RateWindow = std::chrono::milliseconds(100);
+	static constexpr float RateSmoothing = 0.5f;
+
+	// a session's texel cap is never scaled further than this from its weighted share
+	static constexpr float MinCorrection = 0.25f;
+	static constexpr float MaxCorrection = 4.f;
+
+	void AdmitWaiting();
+
+	ThreadPool myPool;
+	size_t myMaxActiveSessions;
+
+	mutable std::mutex myMutex;
+
+	std::vector<Session> myActive;
+	std::deque<Session> myWaiting;
+	uint64_t myTotalWeight;
+
+	SessionId myNextId;
+};
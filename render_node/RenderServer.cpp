@@ -2,34 +2,57 @@
 #include "tools/SystemValues.h"
 
 #include "RenderServer.h"
+#include "CompactTexel.h"
 #include "RayRenderer.h"
-#include "ThreadedRenderer.h"
+#include "WavefrontRenderer.h"
 #include "intersectors/ClusteredIntersector.h"
-#include "RenderCollection.h"
 #include "Version.h"
 
 #include <iostream>
+#include <thread>
 
-RenderServer::RenderServer(std::shared_ptr<fisk::tools::TCPSocket> aSocket)
+RenderServer::RenderServer(std::shared_ptr<fisk::tools::TCPSocket> aSocket, NodeScheduler& aScheduler, ResourceBudget& aBudget, ResultSignal& aResultSignal, const NodeOptions& aOptions)
 	: myState(State::SendSystemvalues)
+	, myHadActivity(false)
 	, mySocket(aSocket)
+	, myScheduler(aScheduler)
+	, myPool(aScheduler.GetPool())
+	, myBudget(aBudget)
+	, myResultSignal(aResultSignal)
+	, myOptions(aOptions)
 	, myReader(aSocket->GetReadStream())
 	, myWriter(aSocket->GetWriteStream())
 	, myAllocatedThreads(0)
+	, myBacklogAt(0)
+	, myTileBacklogAt(0)
+	, myOutstanding(0)
+	, myTileTexelsInFlight(0)
+	, myUnreadBytes(0)
 {
 }
 
-void RenderServer::Update()
+RenderServer::~RenderServer()
+{
+	LogStatistics();
+
+	if (mySession)
+		myScheduler.Leave(*mySession);
+}
+
+bool RenderServer::Update()
 {
 	if (myState == State::Failure)
-		return;
+		return false;
 
 	if (!mySocket->Update())
 	{
 		Fail("Socket closed");
-		return;
+		return true;
 	}
 
+	State before = myState;
+	myHadActivity = false;
+
 	switch (myState)
 	{
 	case RenderServer::State::SendSystemvalues:
@@ -66,6 +89,8 @@ void RenderServer::Update()
 	case RenderServer::State::Failure:
 		break;
 	}
+
+	return myHadActivity || myState != before;
 }
 
 bool RenderServer::IsDone()
@@ -80,6 +105,14 @@ bool RenderServer::IsDone()
 	}
 }
 
+std::optional<std::chrono::steady_clock::time_point> RenderServer::GetBatchDeadline() const
+{
+	if (myBatch.IsEmpty())
+		return {};
+
+	return myBatchStart + std::chrono::microseconds(myRenderConfig.myResultBatchMicroseconds);
+}
+
 void RenderServer::StepSendSystemValues()
 {
 	Log("Sending system values");
@@ -144,31 +177,33 @@ void RenderServer::StepRecvRenderConfig()
 	if (!myReader.ProcessAndCommit(myRenderConfig))
 		return;
 
+	if (!myRenderConfig.IsValid())
+	{
+		Fail("Invalid render config, samples per pass has to divide samples per texel");
+		return;
+	}
+
 	Log("Config recieved");
 	myState = State::AllocateResources;
 }
 
 void RenderServer::StepAllocateResources()
 {
-	Log("TODO: wait for other renders to finish if they're in progress");
-	
-	myAllocatedThreads = std::thread::hardware_concurrency();
-
-	if (myAllocatedThreads == 0)
+	if (!mySession)
 	{
-		myAllocatedThreads = 1;
-	}
-	else if (myAllocatedThreads < 2)
-	{
-		myAllocatedThreads = 1;
-	}
-	else
-	{
-		myAllocatedThreads -= 1;
+		mySession = myScheduler.Enqueue(myRenderConfig.myPriority);
+
+		if (!myScheduler.IsAdmitted(*mySession))
+			Log("Node busy, queued at position " + std::to_string(myScheduler.GetQueuePosition(*mySession)));
 	}
 
-	myLimits.myMaxPending = myAllocatedThreads * 128;
-	myLimits.myThreads = myAllocatedThreads;
+	if (!myScheduler.IsAdmitted(*mySession))
+		return;
+
+	myLimits = myBudget.LimitsFor(myRenderConfig);
+	myAllocatedThreads = static_cast<int>(myLimits.myThreads);
+
+	Log("Allocated " + std::to_string(myLimits.myThreads) + " threads, " + std::to_string(myLimits.myMaxPending) + " pending texels");
 
 	myState = State::SendLimits;
 }
@@ -191,25 +226,33 @@ void RenderServer::StepRecvScene()
 
 void RenderServer::StepStartRendering()
 {
-	switch (myRenderConfig.myMode)
+	if (myRenderConfig.myTexelEncoding == RenderConfig::CompactTexels && !CompactTexel::CanEncode(*myScene, myRenderConfig.myRenderId))
 	{
-	case RenderConfig::RaytracedClustered:
-		myIntersector = std::make_unique<ClusteredIntersector>(*myScene, 8, 8);
-		myBaseRenderer = std::make_unique<RayRenderer>(*myScene, *myIntersector, myRenderConfig.mySamplesPerTexel, myRenderConfig.myRenderId);
-		break;
-	default:
-		break;
+		Fail("Scene ids do not fit the compact texel encoding");
+		return;
+	}
+
+	if (myOptions.myNumaMode == NodeOptions::NumaMode::Replicate && myPool.GetDomainCount() > 1)
+	{
+		if (!ReplicatePerDomain())
+			return;
+	}
+	else if (!CreateRenderer(*myScene, myDomains.emplace_back()))
+	{
+		Fail("Unsupported render mode");
+		return;
 	}
-	
-	std::vector<std::unique_ptr<IAsyncRenderer<TextureType::PackedValues>>> renderers;
 
-	renderers.resize(myAllocatedThreads);
+	std::vector<IRenderer<TextureType::PackedValues>*> renderers;
+
+	for (size_t i = 0; i < myPool.GetDomainCount(); i++)
+		renderers.push_back(myDomains[i % myDomains.size()].myBaseRenderer.get());
 
-	for (auto& subRenderer : renderers)
-		subRenderer = std::make_unique<ThreadedRenderer<TextureType::PackedValues, 128>>(*myBaseRenderer);
-		
+	myRenderer = std::make_unique<PooledRenderer<TextureType::PackedValues>>(myPool, renderers, myLimits.myMaxPending);
+	myRenderer->SetResultSignal(&myResultSignal);
+	myResults.resize(ResultBatchSize);
 
-	myRenderer = std::make_unique<RenderCollection<TextureType::PackedValues>>(std::move(renderers));
+	myRenderStart = std::chrono::steady_clock::now();
 
 	Log("Rendering started");
 	myState = State::Running;
@@ -217,41 +260,299 @@ void RenderServer::StepStartRendering()
 
 void RenderServer::StepRunning()
 {
-	fisk::tools::V2ui uv;
+	// the share changes as other sessions come and go, the client is still held to the limits it was sent
+	myScheduler.ReportBusyTime(*mySession, myRenderer->GetBusyTime());
+
+	size_t share = std::max<size_t>(1, static_cast<size_t>(myLimits.myMaxPending * myScheduler.GetShare(*mySession)));
+	myRenderer->SetMaxPending(share);
 
-	if (myReader.ProcessAndCommit(uv))
+	RenderRequest request;
+
+	while (myReader.ProcessAndCommit(request))
 	{
-		if (myRenderer->GetPending() >= myLimits.myMaxPending)
+		myHadActivity = true;
+
+		if (request.myKind == RenderRequest::BatchRead)
 		{
-			Fail("Client exceeded budget");
+			if (mySentBatches.empty())
+			{
+				Fail("Client read a batch that was never sent");
+				return;
+			}
+
+			myUnreadBytes -= mySentBatches.front();
+			mySentBatches.pop_front();
+			continue;
+		}
+
+		size_t area = request.myRect.Area();
+
+		if (area == 0)
+		{
+			Fail("Client sent an empty tile");
 			return;
 		}
 
-		if (!myRenderer->CanRender(uv))
+		if (myOutstanding + area > myLimits.myMaxPending)
 		{
-			Fail("Renderer busy");
+			Fail("Client exceeded budget");
 			return;
 		}
 
-		myRenderer->Render(uv);
+		myOutstanding += area;
+
+		if (request.myKind == RenderRequest::Texel)
+			myBacklog.push_back(request.myRect.myOrigin);
+		else
+			myTileBacklog.push_back(request.myRect);
+	}
+
+	myBacklogAt += myRenderer->RenderBatch(std::span<const fisk::tools::V2ui>(myBacklog).subspan(myBacklogAt));
+
+	if (myBacklogAt * 2 >= myBacklog.size())
+	{
+		myBacklog.erase(myBacklog.begin(), myBacklog.begin() + myBacklogAt);
+		myBacklogAt = 0;
 	}
 
-	IAsyncRenderer<TextureType::PackedValues>::Result result;
-	while (myRenderer->GetResult(result))
+	while (myTileBacklogAt < myTileBacklog.size())
 	{
-		myWriter.DataProcessor::Process(result);
+		TexelRect rect = myTileBacklog[myTileBacklogAt];
+
+		// a tile larger than the whole share still has to go through on its own
+		bool fits = myTileTexelsInFlight == 0 || myTileTexelsInFlight + rect.Area() <= share;
+
+		if (!fits || !myRenderer->CanRenderTile(rect))
+			break;
+
+		myRenderer->RenderTile(rect);
+		myTileTexelsInFlight += rect.Area();
+		myTileBacklogAt++;
 	}
 
+	if (myTileBacklogAt * 2 >= myTileBacklog.size())
+	{
+		myTileBacklog.erase(myTileBacklog.begin(), myTileBacklog.begin() + myTileBacklogAt);
+		myTileBacklogAt = 0;
+	}
+
+	bool compact = myRenderConfig.myTexelEncoding == RenderConfig::CompactTexels;
+
+	// a client that does not keep up leaves the results in the renderer, which then stops taking work
+	size_t maxUnread = std::max<size_t>(MaxUnreadBytes, myRenderConfig.myResultBatchBytes * 2);
+	size_t maxResults = myUnreadBytes + myBatch.GetBytes() < maxUnread ? MaxResultsPerUpdate : 0;
+
+	size_t sent = 0;
+
+	while (sent < maxResults)
+	{
+		size_t count = myRenderer->GetResults(std::span(myResults).first(std::min(myResults.size(), maxResults - sent)));
+		sent += count;
+		myOutstanding -= count;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			ResultMessage<TextureType::PackedValues> message;
+			message.myKind = RenderRequest::Texel;
+
+			if (compact)
+				message.myCompactTexel = CompactResult::Pack(myResults[i]);
+			else
+				message.myTexel = myResults[i];
+
+			Batch(message);
+		}
+
+		if (count < myResults.size())
+			break;
+	}
+
+	while (sent < maxResults && myRenderer->GetTileResult(myTile))
+	{
+		size_t area = myTile.myRect.Area();
+
+		ResultMessage<TextureType::PackedValues> message;
+		message.myKind = RenderRequest::Tile;
+		message.myRect = myTile.myRect;
+
+		if (compact)
+		{
+			message.myCompactTexels.resize(area);
+
+			for (size_t i = 0; i < area; i++)
+				message.myCompactTexels[i] = CompactTexel::Pack(myTile.myTexels[i]);
+		}
+		else
+		{
+			message.myTexels.swap(myTile.myTexels);
+		}
+
+		Batch(message);
+
+		sent += area;
+		myOutstanding -= area;
+		myTileTexelsInFlight -= area;
+	}
+
+	// results wake the session through the result signal, only a drain cut short by the cap leaves some that no
+	// signal is coming for
+	if (maxResults > 0 && sent >= maxResults)
+		myHadActivity = true;
+
+	if (!myBatch.IsEmpty())
+	{
+		// when everything the client asked for is in the batch nothing is left to wait for, otherwise the session
+		// thread runs this again at the deadline
+		bool due = myOutstanding == 0
+			|| myRenderConfig.myResultBatchBytes == 0
+			|| std::chrono::steady_clock::now() >= *GetBatchDeadline();
+
+		if (due)
+			SendBatch();
+	}
+}
+
+void RenderServer::Batch(ResultMessage<TextureType::PackedValues>& aMessage)
+{
+	if (myBatch.IsEmpty())
+		myBatchStart = std::chrono::steady_clock::now();
+
+	aMessage.myEncoding = myRenderConfig.myTexelEncoding;
+	myBatch.Add(aMessage);
+
+	if (myRenderConfig.myResultBatchBytes > 0 && myBatch.GetBytes() >= myRenderConfig.myResultBatchBytes)
+		SendBatch();
+}
+
+void RenderServer::SendBatch()
+{
+	myWriter.DataProcessor::Process(myBatch);
+
+	myUnreadBytes += myBatch.GetBytes();
+	mySentBatches.push_back(myBatch.GetBytes());
+
+	myBatch.Clear();
+
+	// the socket only writes on Update, so the batch goes out now instead of on the next poll
+	if (!mySocket->Update())
+		Fail("Socket closed");
+}
+
+bool RenderServer::CreateRenderer(const Scene& aScene, DomainResources& aOut)
+{
+	switch (myRenderConfig.myMode)
+	{
+	case RenderConfig::RaytracedClustered:
+	{
+		std::unique_ptr<ClusteredIntersector> intersector = std::make_unique<ClusteredIntersector>(aScene, 8, 8);
+
+		using Renderer = RayRenderer<ClusteredIntersector, Camera>;
+
+		std::unique_ptr<Renderer> rayRenderer = std::make_unique<Renderer>(aScene, *intersector, myRenderConfig.GetSamplesPerPass(), myRenderConfig.myMinBounces, myRenderConfig.myRenderId);
+		aOut.myPathStatistics = &rayRenderer->GetStatistics();
+		aOut.myBaseRenderer = std::move(rayRenderer);
+		aOut.myIntersector = std::move(intersector);
+	}
+		return true;
+	case RenderConfig::WavefrontClustered:
+	{
+		aOut.myIntersector = std::make_unique<ClusteredIntersector>(aScene, 8, 8);
+
+		std::unique_ptr<WavefrontRenderer> wavefrontRenderer = std::make_unique<WavefrontRenderer>(aScene, *aOut.myIntersector, myRenderConfig.GetSamplesPerPass(), myRenderConfig.myMinBounces, myRenderConfig.myRayOrdering == RenderConfig::SortSecondary, myRenderConfig.myRenderId);
+		aOut.myPathStatistics = &wavefrontRenderer->GetStatistics();
+		aOut.myBaseRenderer = std::move(wavefrontRenderer);
+	}
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool RenderServer::ReplicatePerDomain()
+{
+	// built on a thread pinned to the domain so first touch places every page of the copy in its local memory
+	myDomains.resize(myPool.GetDomainCount());
+
+	std::vector<std::thread> builders;
+
+	for (size_t i = 0; i < myDomains.size(); i++)
+	{
+		builders.emplace_back([this, i]()
+		{
+			NumaTopology::PinCurrentThread(myPool.GetDomainCpus(i));
+
+			DomainResources& domain = myDomains[i];
+			domain.myScene = myScene->Clone();
+
+			CreateRenderer(*domain.myScene, domain);
+		});
+	}
+
+	for (std::thread& builder : builders)
+		builder.join();
+
+	if (!myDomains[0].myBaseRenderer)
+	{
+		Fail("Unsupported render mode");
+		return false;
+	}
+
+	Log("Scene replicated to " + std::to_string(myDomains.size()) + " NUMA domains");
+	return true;
+}
+
+void RenderServer::LogStatistics()
+{
+	path_tracing::Statistics statistics;
+
+	for (DomainResources& domain : myDomains)
+	{
+		if (!domain.myPathStatistics)
+			continue;
+
+		path_tracing::Statistics domainStatistics = domain.myPathStatistics->Get();
+
+		statistics.myPaths += domainStatistics.myPaths;
+		statistics.mySegments += domainStatistics.mySegments;
+		statistics.myTerminated += domainStatistics.myTerminated;
+		statistics.myIntersectionTime += domainStatistics.myIntersectionTime;
+	}
+
+	if (statistics.myPaths == 0)
+		return;
+
+	Log("Paths traced: " + std::to_string(statistics.myPaths)
+		+ " average length: " + std::to_string(statistics.AveragePathLength())
+		+ " terminated by roulette: " + std::to_string(statistics.myTerminated)
+		+ " intersection time: " + std::to_string(statistics.myIntersectionTime / 1000000) + "ms");
+
+	if (!myRenderer)
+		return;
+
+	size_t texels = 0;
+	for (size_t i = 0; i < myPool.GetDomainCount(); i++)
+		texels += myRenderer->GetRenderedTexels(i);
+
+	myBudget.RecordThroughput(texels, myRenderConfig.GetSamplesPerPass(), myRenderer->GetBusyTime());
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - myRenderStart).count();
+
+	for (size_t i = 0; i < myPool.GetDomainCount(); i++)
+	{
+		size_t domainTexels = myRenderer->GetRenderedTexels(i);
+
+		Log("Domain " + std::to_string(i) + ": " + std::to_string(domainTexels) + " texels, " + std::to_string(static_cast<size_t>(domainTexels / std::max(seconds, 0.001f))) + " texels/s");
+	}
 }
 
 void RenderServer::Log(std::string aMessage)
 {
-	std::cout << aMessage << "\n";
+	std::cout << aMessage + "\n";
 }
 
 void RenderServer::Fail(std::string aMessage)
 {
 	myState = State::Failure;
-	std::cout << "Failure: " << aMessage << "\n";
+	std::cout << "Failure: " + aMessage + "\n";
 }
 
@@ -6,23 +6,40 @@
 #include "tools/StreamWriter.h"
 
 #include "NodeLimits.h"
+#include "NodeOptions.h"
+#include "NodeScheduler.h"
 #include "RenderConfig.h"
+#include "RenderMessages.h"
 #include "Scene.h"
 #include "IIntersector.h"
 #include "IRenderer.h"
 #include "RendererTypes.h"
+#include "PathTracing.h"
+#include "PooledRenderer.h"
+#include "ResourceBudget.h"
+#include "ResultSignal.h"
+#include "ThreadPool.h"
 
+#include <chrono>
+#include <deque>
 #include <memory>
+#include <optional>
+#include <vector>
 
 class RenderServer
 {
 public:
-	RenderServer(std::shared_ptr<fisk::tools::TCPSocket> aSocket);
+	RenderServer(std::shared_ptr<fisk::tools::TCPSocket> aSocket, NodeScheduler& aScheduler, ResourceBudget& aBudget, ResultSignal& aResultSignal, const NodeOptions& aOptions);
+	~RenderServer();
 
-	void Update();
+	/// Returns true if anything was sent, received or moved the session along
+	bool Update();
 
 	bool IsDone();
 
+	/// When the results held back for batching have to be sent, empty while nothing is held back
+	std::optional<std::chrono::steady_clock::time_point> GetBatchDeadline() const;
+
 private:
 
 	enum class State
@@ -52,11 +69,38 @@ private:
 	void StepStartRendering();
 	void StepRunning();
 
+	/// Everything a renderer reads while tracing, one of these per NUMA domain when replicating
+	struct DomainResources
+	{
+		std::unique_ptr<Scene> myScene; // empty when using the shared scene
+		std::unique_ptr<IIntersector> myIntersector;
+		std::unique_ptr<IRenderer<TextureType::PackedValues>> myBaseRenderer;
+		const path_tracing::StatisticsCounter* myPathStatistics = nullptr;
+	};
+
+	/// Returns false for render modes the node does not support, safe to call from any thread
+	bool CreateRenderer(const Scene& aScene, DomainResources& aOut);
+	bool ReplicatePerDomain();
+
+	/// Holds aMessage back until the batch is large enough or has waited long enough, see RenderConfig
+	void Batch(ResultMessage<TextureType::PackedValues>& aMessage);
+
+	/// Writes the batch as one buffer and flushes the socket right away
+	void SendBatch();
+
+	void LogStatistics();
 	void Log(std::string aMessage);
 	void Fail(std::string aMessage);
 
 	State myState;
+	bool myHadActivity;
 	std::shared_ptr<fisk::tools::TCPSocket> mySocket;
+	NodeScheduler& myScheduler;
+	ThreadPool& myPool;
+	std::optional<NodeScheduler::SessionId> mySession;
+	ResourceBudget& myBudget;
+	ResultSignal& myResultSignal;
+	const NodeOptions& myOptions;
 
 	NodeLimits myLimits;
 	RenderConfig myRenderConfig;
@@ -66,7 +110,29 @@ private:
 	std::unique_ptr<Scene> myScene;
 	int myAllocatedThreads;
 
-	std::unique_ptr<IIntersector> myIntersector;
-	std::unique_ptr<IRenderer<TextureType::PackedValues>> myBaseRenderer;
-	std::unique_ptr<IAsyncRenderer<TextureType::PackedValues>> myRenderer;
+	std::vector<DomainResources> myDomains;
+	std::unique_ptr<PooledRenderer<TextureType::PackedValues>> myRenderer;
+	std::chrono::steady_clock::time_point myRenderStart;
+
+	// texels and tiles the client sent that do not fit this session's current share of the pool
+	std::vector<fisk::tools::V2ui> myBacklog;
+	size_t myBacklogAt;
+	std::vector<TexelRect> myTileBacklog;
+	size_t myTileBacklogAt;
+
+	size_t myOutstanding;		// texels the client asked for that have not been sent back, held to myLimits.myMaxPending
+	size_t myTileTexelsInFlight;	// a tile is one job to the renderer, so its texels are counted against the share here
+
+	static constexpr size_t ResultBatchSize = 256;
+	static constexpr size_t MaxResultsPerUpdate = 4096; // in texels, keeps one update from batching everything at once
+	static constexpr size_t MaxUnreadBytes = 1 << 20;	// written ahead of the client before results are left in the renderer, at least two batches
+	std::vector<IAsyncRenderer<TextureType::PackedValues>::Result> myResults; // drained into in bulk every update
+	IAsyncRenderer<TextureType::PackedValues>::TileResult myTile;
+
+	ResultBatch<TextureType::PackedValues> myBatch;
+	std::chrono::steady_clock::time_point myBatchStart; // when the oldest message in myBatch was added
+
+	// the socket can not tell what it has not sent yet, so this counts what the client has not said it read, which covers it
+	size_t myUnreadBytes;
+	std::deque<size_t> mySentBatches; // bytes of every batch sent and not yet read, oldest first
 };
\ No newline at end of file
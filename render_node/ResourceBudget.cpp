@@ -0,0 +1,172 @@
+#include "ResourceBudget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	/// Lines of /proc/self/cgroup are "hierarchy:controllers:path", v2 has hierarchy 0 and no controllers
+	std::optional<std::string> CgroupPath(bool aUnified)
+	{
+		std::ifstream file("/proc/self/cgroup");
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			size_t first = line.find(':');
+			size_t second = line.find(':', first + 1);
+
+			if (first == std::string::npos || second == std::string::npos)
+				continue;
+
+			std::string controllers = line.substr(first + 1, second - first - 1);
+
+			if (aUnified ? controllers.empty() : (',' + controllers + ',').find(",cpu,") != std::string::npos)
+				return line.substr(second + 1);
+		}
+
+		return {};
+	}
+
+	/// The quota of a group is also capped by every group above it, take the tightest one from aPath up to the root
+	template<class ReadQuota>
+	std::optional<float> TightestQuota(const std::filesystem::path& aRoot, const std::string& aPath, ReadQuota&& aReadQuota)
+	{
+		std::optional<float> out;
+
+		std::filesystem::path relative = std::filesystem::path(aPath).relative_path();
+
+		while (true)
+		{
+			if (std::optional<float> quota = aReadQuota(aRoot / relative))
+				out = std::min(out.value_or(*quota), *quota);
+
+			if (relative.empty())
+				break;
+
+			relative = relative.parent_path();
+		}
+
+		return out;
+	}
+
+	std::optional<float> ReadV2Quota(const std::filesystem::path& aGroup)
+	{
+		std::ifstream file(aGroup / "cpu.max");
+		std::string quota;
+		float period = 0;
+
+		if (!(file >> quota >> period) || quota == "max" || period <= 0)
+			return {};
+
+		return std::stof(quota) / period;
+	}
+
+	std::optional<float> ReadV1Quota(const std::filesystem::path& aGroup)
+	{
+		std::ifstream quotaFile(aGroup / "cpu.cfs_quota_us");
+		std::ifstream periodFile(aGroup / "cpu.cfs_period_us");
+		long long quota = 0;
+		long long period = 0;
+
+		if (!(quotaFile >> quota) || !(periodFile >> period) || quota <= 0 || period <= 0)
+			return {};
+
+		return static_cast<float>(quota) / static_cast<float>(period);
+	}
+}
+
+ResourceBudget::ResourceBudget(const NumaTopology& aTopology, const NodeOptions& aOptions)
+	: myMaxPendingOverride(aOptions.myMaxPending)
+{
+	size_t cpus = aTopology.GetCpuCount();
+	std::optional<float> quota = CgroupCpuQuota();
+
+	if (quota)
+		cpus = std::min(cpus, static_cast<size_t>(std::max(1.f, std::ceil(*quota))));
+
+	// one core is left for the session I/O threads, they mostly sleep
+	myThreads = aOptions.myThreads.value_or(cpus < 2 ? 1 : cpus - 1);
+
+	std::cout << "Cpus: " << aTopology.GetCpuCount() << " allowed"
+		<< (quota ? ", " + std::to_string(*quota) + " by cgroup quota" : std::string())
+		<< ", using " << myThreads << " worker threads" << (aOptions.myThreads ? " (overridden)" : "") << "\n";
+}
+
+std::optional<float> ResourceBudget::CgroupCpuQuota()
+{
+#ifdef __linux__
+	if (std::optional<std::string> path = CgroupPath(true))
+	{
+		if (std::optional<float> quota = TightestQuota("/sys/fs/cgroup", *path, ReadV2Quota))
+			return quota;
+	}
+
+	if (std::optional<std::string> path = CgroupPath(false))
+	{
+		for (const char* mount : { "/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct" })
+		{
+			if (std::optional<float> quota = TightestQuota(mount, *path, ReadV1Quota))
+				return quota;
+		}
+	}
+#endif
+
+	return {};
+}
+
+size_t ResourceBudget::GetThreads() const
+{
+	return myThreads;
+}
+
+NodeLimits ResourceBudget::LimitsFor(const RenderConfig& aConfig) const
+{
+	NodeLimits limits;
+	limits.myThreads = static_cast<uint32_t>(myThreads);
+
+	if (myMaxPendingOverride)
+	{
+		limits.myMaxPending = static_cast<uint32_t>(*myMaxPendingOverride);
+		return limits;
+	}
+
+	size_t perThread = FallbackPendingPerThread;
+
+	std::lock_guard lock(myMutex);
+
+	if (mySamplesPerThreadSecond)
+	{
+		float texelsPerSecond = *mySamplesPerThreadSecond / static_cast<float>(std::max<size_t>(aConfig.GetSamplesPerPass(), 1));
+
+		perThread = std::clamp(static_cast<size_t>(texelsPerSecond * TargetQueueSeconds), MinPendingPerThread, MaxPendingPerThread);
+	}
+
+	limits.myMaxPending = static_cast<uint32_t>(perThread * myThreads);
+
+	return limits;
+}
+
+void ResourceBudget::RecordThroughput(size_t aTexels, size_t aSamplesPerTexel, std::chrono::nanoseconds aBusyTime)
+{
+	float seconds = std::chrono::duration<float>(aBusyTime).count();
+
+	// too little to say anything, the session most likely ended before it got going
+	if (aTexels == 0 || seconds < 0.01f)
+		return;
+
+	float samplesPerThreadSecond = static_cast<float>(aTexels * aSamplesPerTexel) / seconds;
+
+	std::lock_guard lock(myMutex);
+
+	if (mySamplesPerThreadSecond)
+		*mySamplesPerThreadSecond += (samplesPerThreadSecond - *mySamplesPerThreadSecond) * ThroughputSmoothing;
+	else
+		mySamplesPerThreadSecond = samplesPerThreadSecond;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "NodeLimits.h"
+#include "NodeOptions.h"
+#include "NumaTopology.h"
+#include "RenderConfig.h"
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+/// How much of the machine the node may use, and how much work a session should keep in flight to use it
+/// Lives as long as the node so what one session measured sizes the next, thread safe
+class ResourceBudget
+{
+public:
+	ResourceBudget(const NumaTopology& aTopology, const NodeOptions& aOptions);
+
+	/// Cpus the cgroup quota pays for, nothing when there is no quota or it can not be read
+	static std::optional<float> CgroupCpuQuota();
+
+	size_t GetThreads() const;
+
+	NodeLimits LimitsFor(const RenderConfig& aConfig) const;
+
+	/// Feeds the per thread throughput estimate, aBusyTime is summed over all threads that did the work
+	void RecordThroughput(size_t aTexels, size_t aSamplesPerTexel, std::chrono::nanoseconds aBusyTime);
+
+private:
+	static constexpr size_t FallbackPendingPerThread = 128;	// before anything has been measured
+	static constexpr size_t MinPendingPerThread = 16;
+	static constexpr size_t MaxPendingPerThread = 4096;
+	static constexpr float TargetQueueSeconds = 0.05f;		// in flight work should cover this much time, enough to hide a network round trip
+	static constexpr float ThroughputSmoothing = 0.5f;
+
+	size_t myThreads;
+	std::optional<size_t> myMaxPendingOverride;
+
+	mutable std::mutex myMutex;
+	std::optional<float> mySamplesPerThreadSecond;
+};
@@ -0,0 +1,87 @@
+#include "SessionThread.h"
+
+#include <algorithm>
+
+SessionThread::SessionThread(std::shared_ptr<fisk::tools::TCPSocket> aSocket, NodeScheduler& aScheduler, ResourceBudget& aBudget, const NodeOptions& aOptions)
+	: myServer(std::make_unique<RenderServer>(aSocket, aScheduler, aBudget, myResultSignal, aOptions))
+	, myPollInterval(MinPollInterval)
+	, myPollTimer(0)
+	, myBatchTimer(0)
+	, myIsDone(false)
+{
+	myResultSignal.SetOnNotify([this]() { myLoop.Wake(); });
+
+	myPollTimer = myLoop.AddTimer(myPollInterval, [this]()
+	{
+		Step();
+	});
+
+	myLoop.OnWake([this]()
+	{
+		Step();
+	});
+
+	myThread = std::thread(&SessionThread::Run, this);
+}
+
+SessionThread::~SessionThread()
+{
+	myLoop.Stop();
+	myThread.join();
+}
+
+bool SessionThread::IsDone() const
+{
+	return myIsDone.load(std::memory_order_acquire);
+}
+
+void SessionThread::Run()
+{
+	myLoop.Run();
+
+	// destroyed here so the socket is only ever used from this thread, this waits for the session's tasks on the pool
+	myServer.reset();
+
+	myIsDone.store(true, std::memory_order_release);
+}
+
+void SessionThread::Step()
+{
+	if (!myServer)
+		return;
+
+	bool active = myServer->Update();
+
+	if (myServer->IsDone())
+	{
+		myLoop.Stop();
+		return;
+	}
+
+	std::optional<EventLoop::Clock::time_point> deadline = myServer->GetBatchDeadline();
+
+	if (deadline != myBatchDeadline)
+	{
+		if (myBatchDeadline)
+			myLoop.RemoveTimer(myBatchTimer);
+
+		if (deadline)
+		{
+			myBatchTimer = myLoop.AddTimeout(*deadline, [this]()
+			{
+				myBatchDeadline.reset();
+				Step();
+			});
+		}
+
+		myBatchDeadline = deadline;
+	}
+
+	std::chrono::microseconds interval = active ? MinPollInterval : std::min(myPollInterval * 2, MaxPollInterval);
+
+	if (interval != myPollInterval)
+	{
+		myPollInterval = interval;
+		myLoop.SetInterval(myPollTimer, myPollInterval);
+	}
+}
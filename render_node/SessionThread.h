@@ -0,0 +1,54 @@
+#pragma once
+
+#include "tools/TCPSocket.h"
+
+#include "EventLoop.h"
+#include "NodeOptions.h"
+#include "NodeScheduler.h"
+#include "RenderServer.h"
+#include "ResourceBudget.h"
+#include "ResultSignal.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+
+/// Runs one connection on its own I/O thread with its own event loop, a slow socket or a large scene upload
+/// then only holds up the session it belongs to. Rendering still happens on the scheduler's pool
+class SessionThread
+{
+public:
+	SessionThread(std::shared_ptr<fisk::tools::TCPSocket> aSocket, NodeScheduler& aScheduler, ResourceBudget& aBudget, const NodeOptions& aOptions);
+
+	/// Stops the session if it is still running and waits for the thread
+	~SessionThread();
+
+	SessionThread(const SessionThread&) = delete;
+	SessionThread& operator=(const SessionThread&) = delete;
+
+	bool IsDone() const;
+
+private:
+	// the socket can not be waited on through fisk::tools, so it is polled, quickly while there is traffic and backing
+	// off while there is none. Finished results wake the loop right away instead of waiting for the next poll
+	static constexpr std::chrono::microseconds MinPollInterval = std::chrono::milliseconds(1);
+	static constexpr std::chrono::microseconds MaxPollInterval = std::chrono::milliseconds(32);
+
+	void Run();
+	void Step();
+
+	EventLoop myLoop;
+	ResultSignal myResultSignal;
+	std::unique_ptr<RenderServer> myServer;	// only touched by the session thread once it is started
+
+	std::chrono::microseconds myPollInterval;
+	EventLoop::TimerId myPollTimer;
+
+	// a timeout at the server's batch deadline, so held back results go out on time whatever the poll interval is
+	std::optional<EventLoop::Clock::time_point> myBatchDeadline;
+	EventLoop::TimerId myBatchTimer;
+
+	std::atomic<bool> myIsDone;
+	std::thread myThread;
+};
@@ -3,6 +3,8 @@
 #include "tools/TCPSocket.h"
 
 #include "NodeLimits.h"
+#include "NodeOptions.h"
+#include "NumaTopology.h"
 #include "RayRenderer.h"
 #include "NetworkedRenderer.h"
 #include "RendererTypes.h"
@@ -10,40 +12,60 @@
 #include "Protocol.h"
 #include "RenderConfig.h"
 #include "intersectors/ClusteredIntersector.h"
-#include "RenderServer.h"
+#include "ResourceBudget.h"
+#include "EventLoop.h"
+#include "NodeScheduler.h"
+#include "SessionThread.h"
 
 #include "Scene.h"
 
-#include <thread>
+#include <algorithm>
+#include <chrono>
+#include <optional>
 #include <iostream>
 
-int main()
+int main(int argc, char** argv)
 {
+	std::optional<NodeOptions> options = NodeOptions::Parse(argc, argv);
+
+	if (!options)
+		return 1;
+
+	NumaTopology topology = options->myNumaMode == NodeOptions::NumaMode::Off
+		? NumaTopology::SingleDomain(NumaTopology::AllowedCpus().size())
+		: NumaTopology::Detect();
+
+	std::cout << "NUMA domains: " << topology.GetDomains().size() << "\n";
+
+	ResourceBudget budget(topology, *options);
+	NodeScheduler scheduler(topology, budget.GetThreads(), options->myNumaMode != NodeOptions::NumaMode::Off, options->myMaxSessions);
+
+	// every session runs on its own thread, this one only accepts connections and cleans up after finished sessions
+	constexpr std::chrono::microseconds AcceptInterval = std::chrono::milliseconds(20);
+
+	EventLoop loop;
+
 	fisk::tools::TCPListenSocket listen(11587);
 
-	std::vector<std::unique_ptr<RenderServer>> connections;
+	std::vector<std::unique_ptr<SessionThread>> sessions;
 
-	fisk::tools::EventReg newConnections = listen.OnNewConnection.Register([&connections](std::shared_ptr<fisk::tools::TCPSocket> aSocket)
+	fisk::tools::EventReg newConnections = listen.OnNewConnection.Register([&sessions, &scheduler, &budget, &options](std::shared_ptr<fisk::tools::TCPSocket> aSocket)
 	{
-		connections.emplace_back(std::make_unique<RenderServer>(aSocket));
+		sessions.emplace_back(std::make_unique<SessionThread>(aSocket, scheduler, budget, *options));
 	});
 
 	std::cout << "Listening on: " << listen.GetPort() << "\n";
 
-	while (listen.Update())
+	loop.AddTimer(AcceptInterval, [&]()
 	{
-		for (int i = static_cast<int>(connections.size()) - 1; i >= 0; i--)
+		if (!listen.Update())
 		{
-			RenderServer& server = *connections[i];
-			server.Update();
-
-			if (server.IsDone())
-			{
-				connections.erase(connections.begin() + i);
-				continue;
-			}
+			loop.Stop();
+			return;
 		}
 
-		std::this_thread::yield();
-	}
-}
\ No newline at end of file
+		sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [](const std::unique_ptr<SessionThread>& aSession) { return aSession->IsDone(); }), sessions.end());
+	});
+
+	loop.Run();
+}
@@ -0,0 +1,146 @@
+#include "EventLoop.h"
+#include "ResultSignal.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	/// Polls aCondition for a few seconds so a loop that never wakes fails the test instead of hanging it
+	template<class Condition>
+	bool WaitFor(Condition&& aCondition)
+	{
+		auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+		while (!aCondition())
+		{
+			if (std::chrono::steady_clock::now() > giveUp)
+				return false;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		return true;
+	}
+
+	void WakeUnblocksRun()
+	{
+		EventLoop loop;
+		std::atomic<int> wakes = 0;
+
+		loop.OnWake([&wakes]() { wakes++; });
+
+		std::thread thread([&loop]() { loop.Run(); });
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		Check(wakes == 0, "a loop without timers sleeps until it is woken");
+
+		loop.Wake();
+		Check(WaitFor([&wakes]() { return wakes == 1; }), "a wake from another thread unblocks Run");
+
+		loop.Wake();
+		Check(WaitFor([&wakes]() { return wakes == 2; }), "a loop goes back to sleep and can be woken again");
+
+		loop.Stop();
+		thread.join();
+	}
+
+	void WakesCoalesce()
+	{
+		EventLoop loop;
+		int wakes = 0;
+
+		loop.OnWake([&wakes]() { wakes++; });
+		loop.AddTimeout(EventLoop::Clock::now() + std::chrono::milliseconds(20), [&loop]() { loop.Stop(); });
+
+		// none of these reach the loop before it runs, they are all the same wake
+		for (int i = 0; i < 100; i++)
+			loop.Wake();
+
+		loop.Run();
+
+		Check(wakes == 1, "wakes that come in before the loop looks are merged into one");
+	}
+
+	void ResultsWakeTheLoop()
+	{
+		constexpr uint64_t Notifies = 1000;
+
+		EventLoop loop;
+		ResultSignal signal;
+
+		std::atomic<int> wakes = 0;
+		std::atomic<uint64_t> seen = 0;
+
+		// the same hookup a session uses, every finished result wakes the loop
+		signal.SetOnNotify([&loop]() { loop.Wake(); });
+		loop.OnWake([&wakes, &seen, &signal]()
+		{
+			wakes++;
+			seen = signal.Current();
+		});
+
+		std::thread thread([&loop]() { loop.Run(); });
+
+		std::thread renderer([&signal]()
+		{
+			for (uint64_t i = 0; i < Notifies; i++)
+				signal.Notify();
+		});
+
+		renderer.join();
+
+		Check(WaitFor([&seen]() { return seen == Notifies; }), "the loop wakes for the last result");
+		Check(wakes <= static_cast<int>(Notifies), "a result wakes the loop at most once");
+
+		loop.Stop();
+		thread.join();
+	}
+
+	void Timers()
+	{
+		EventLoop loop;
+
+		int repeats = 0;
+		int timeouts = 0;
+		int cancelled = 0;
+
+		loop.AddTimer(std::chrono::milliseconds(2), [&repeats]() { repeats++; });
+		loop.AddTimeout(EventLoop::Clock::now() + std::chrono::milliseconds(5), [&timeouts]() { timeouts++; });
+
+		EventLoop::TimerId removed = loop.AddTimeout(EventLoop::Clock::now() + std::chrono::milliseconds(5), [&cancelled]() { cancelled++; });
+		loop.RemoveTimer(removed);
+
+		loop.AddTimeout(EventLoop::Clock::now() + std::chrono::milliseconds(40), [&loop]() { loop.Stop(); });
+
+		loop.Run();
+
+		Check(repeats >= 5, "a timer keeps repeating");
+		Check(timeouts == 1, "a timeout runs once");
+		Check(cancelled == 0, "a removed timeout never runs");
+	}
+}
+
+int main()
+{
+	WakeUnblocksRun();
+	WakesCoalesce();
+	ResultsWakeTheLoop();
+	Timers();
+
+	return globalFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include "NodeScheduler.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+	int globalFailures = 0;
+
+	void Check(bool aCondition, const char* aWhat)
+	{
+		if (aCondition)
+			return;
+
+		std::cout << "Failed: " << aWhat << "\n";
+		globalFailures++;
+	}
+
+	void Admission()
+	{
+		NodeScheduler scheduler(NumaTopology::SingleDomain(1), 1, false, 2);
+
+		NodeScheduler::SessionId first = scheduler.Enqueue(1);
+		NodeScheduler::SessionId second = scheduler.Enqueue(3);
+		NodeScheduler::SessionId third = scheduler.Enqueue(1);
+
+		Check(scheduler.IsAdmitted(first) && scheduler.IsAdmitted(second), "sessions are admitted while there is room");
+		Check(!scheduler.IsAdmitted(third) && scheduler.GetQueuePosition(third) == 1, "the rest wait in line");
+		Check(scheduler.GetShare(first) == 0.25f && scheduler.GetShare(second) == 0.75f, "shares follow the weights");
+		Check(scheduler.GetShare(third) == 0.f, "a waiting session has no share");
+
+		scheduler.Leave(second);
+
+		Check(scheduler.IsAdmitted(third), "the next in line is admitted when a session leaves");
+		Check(scheduler.GetShare(first) == 0.5f, "shares are spread over the sessions left");
+	}
+
+	void BusyTimeCorrection()
+	{
+		NodeScheduler scheduler(NumaTopology::SingleDomain(1), 1, false, 2);
+
+		NodeScheduler::SessionId heavy = scheduler.Enqueue(1);
+		NodeScheduler::SessionId light = scheduler.Enqueue(1);
+
+		Check(scheduler.GetShare(heavy) == scheduler.GetShare(light), "equal weights start out with equal shares");
+
+		// same weight, but the heavy session's texels take three times the pool time
+		std::chrono::nanoseconds heavyBusy{};
+		std::chrono::nanoseconds lightBusy{};
+
+		for (int i = 0; i < 4; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(110));
+
+			heavyBusy += std::chrono::milliseconds(300);
+			lightBusy += std::chrono::milliseconds(100);
+
+			scheduler.ReportBusyTime(heavy, heavyBusy);
+			scheduler.ReportBusyTime(light, lightBusy);
+		}
+
+		Check(scheduler.GetShare(heavy) < 0.5f, "a session using more than its share of the pool gets fewer texels");
+		Check(scheduler.GetShare(light) > 0.5f, "a session using less than its share of the pool gets more texels");
+		Check(scheduler.GetShare(heavy) >= 0.5f * 0.25f, "the correction is bounded");
+	}
+}
+
+int main()
+{
+	Admission();
+	BusyTimeCorrection();
+
+	return globalFailures == 0 ? 0 : 1;
+}